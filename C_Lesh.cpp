@@ -4,6 +4,25 @@
 // ============================================================================
 
 #include "C_Lesh.h"
+#include <cstddef>
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64)
+  #define C_LESH_BLIT_SSE2
+  #include <emmintrin.h>
+#endif
+#if defined(C_LESH_BLIT_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define C_LESH_BLIT_AVX2 // Shares the SSE2 index kernels.
+  #include <immintrin.h>
+#endif
+#ifdef _WIN32
+  #include <windows.h>
+  #include <psapi.h>
+#else
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
 
 Codeloader::cC_Lesh* clsh = NULL;
 
@@ -15,29 +34,134 @@ bool Process_Keys();
 // **************************************************************************
 
 int main(int argc, char** argv) {
-  if (argc == 4) {
+  if (((argc == 4) || (argc == 5)) && (std::string(argv[1]) == "convert")) {
+    std::string source = argv[2];
+    std::string image = argv[3];
+    try {
+      std::vector<Codeloader::sImage_Entry> entries;
+      std::vector<int> cells;
+      if ((argc == 5) && (std::string(argv[4]) == "list")) {
+        Codeloader::cC_Lesh::Parse_File_List(source, entries, cells);
+      }
+      else {
+        Codeloader::cC_Lesh::Parse_Table_List(source, entries, cells);
+      }
+      Codeloader::cC_Lesh::Save_Image(image, entries, cells);
+      std::cout << "Converted " << entries.size() << " tables to " << image << "." << std::endl;
+    }
+    catch (Codeloader::cError error) {
+      error.Print();
+    }
+  }
+  else if ((argc == 3) && (std::string(argv[1]) == "blit") && (std::string(argv[2]) == "check")) {
+    try {
+      Codeloader::cFrame_Buffer::Check_Blitters();
+    }
+    catch (Codeloader::cError error) {
+      error.Print();
+      return 1;
+    }
+  }
+  else if ((argc == 4) && (std::string(argv[1]) == "blit")) {
+    try {
+      Codeloader::cFrame_Buffer::Benchmark(Codeloader::Text_To_Number(argv[2]), Codeloader::Text_To_Number(argv[3]));
+    }
+    catch (Codeloader::cError error) {
+      error.Print();
+    }
+  }
+  else if ((argc >= 5) && (std::string(argv[1]) == "startup")) {
+    try {
+      std::vector<int> counts;
+      for (int arg_index = 4; arg_index < argc; arg_index++) {
+        counts.push_back(Codeloader::Text_To_Number(argv[arg_index]));
+      }
+      Codeloader::cC_Lesh::Benchmark_Startup(Codeloader::Text_To_Number(argv[2]), Codeloader::Text_To_Number(argv[3]), counts);
+    }
+    catch (Codeloader::cError error) {
+      error.Print();
+    }
+  }
+  else if ((argc == 4) && (std::string(argv[1]) == "translate")) {
+    std::string program = argv[2];
+    std::string output = argv[3];
+    try {
+      Codeloader::cC_Lesh translator(NULL, NULL, "Config");
+      translator.Load_Program(program);
+      translator.Translate(program, output);
+      std::cout << "Translated " << program << " to " << output << "." << std::endl;
+    }
+    catch (Codeloader::cError error) {
+      error.Print();
+    }
+  }
+  else if ((argc >= 4) && (argc <= 8)) {
     std::string program = argv[1];
     int width = Codeloader::Text_To_Number(argv[2]);
     int height = Codeloader::Text_To_Number(argv[3]);
+    std::string mode = (argc >= 5) ? argv[4] : "";
     try {
-      Codeloader::cPicture_Processor pp(width, height);
-      Codeloader::cAllegro_IO allegro(program, width, height, 2, "Game");
-      clsh = new Codeloader::cC_Lesh(&pp, &allegro, "Config");
-      allegro.Load_Resources("Resources");
-      allegro.Load_Button_Names("Button_Names");
-      allegro.Load_Button_Map("Buttons");
-      clsh->Load_Program(program);
-      allegro.Process_Messages(Source_Process, Process_Keys);
+      Codeloader::cPicture_Processor pp(width, height); // Offscreen unless presented by Allegro.
+      if ((mode == "batch") || (mode == "bench")) {
+        std::string input = (argc >= 6) ? argv[5] : "";
+        std::string log = (argc >= 7) ? argv[6] : program + "_Log.txt";
+        std::string dump = (argc >= 8) ? argv[7] : "";
+        Codeloader::cNull_IO null_io(input, log);
+        clsh = new Codeloader::cC_Lesh(&pp, &null_io, "Config");
+        try {
+          clsh->Set_Screen_Size(width, height);
+          if (mode == "bench") {
+            clsh->Benchmark_Dispatch(program);
+          }
+          else {
+            clsh->Run_Batch(program);
+            std::cout << "frames=" << null_io.frame_count << std::endl;
+          }
+        }
+        catch (Codeloader::cError error) {
+          error.Print();
+        }
+        if (dump.length() > 0) {
+          try {
+            clsh->Dump_Memory(dump); // Also after an error so the memory it left can be compared.
+          }
+          catch (Codeloader::cError error) {
+            error.Print();
+          }
+        }
+        delete clsh; // The present thread has to stop while the display is still there.
+        clsh = NULL;
+      }
+      else {
+        Codeloader::cAllegro_Frame_IO allegro(program, width, height, 2, "Game");
+        clsh = new Codeloader::cC_Lesh(&pp, &allegro, "Config");
+        try {
+          clsh->Set_Screen_Size(width, height);
+          allegro.Load_Resources("Resources");
+          allegro.Load_Button_Names("Button_Names");
+          allegro.Load_Button_Map("Buttons");
+          clsh->Load_Program(program);
+          allegro.Process_Messages(Source_Process, Process_Keys);
+        }
+        catch (Codeloader::cError error) {
+          error.Print();
+        }
+        delete clsh; // The present thread has to stop while the display is still there.
+        clsh = NULL;
+      }
     }
     catch (Codeloader::cError error) {
       error.Print();
     }
-    if (clsh) {
-      delete clsh;
-    }
   }
   else {
     std::cout << "Usage: " << argv[0] << " <program> <width> <height>" << std::endl;
+    std::cout << "       " << argv[0] << " <program> <width> <height> batch|bench [<input> [<log> [<dump>]]]" << std::endl;
+    std::cout << "       " << argv[0] << " convert <source> <image> [list]" << std::endl;
+    std::cout << "       " << argv[0] << " translate <program> <output.cpp>" << std::endl;
+    std::cout << "       " << argv[0] << " startup <width> <height> <count> [<count> ...]" << std::endl;
+    std::cout << "       " << argv[0] << " blit <width> <height>" << std::endl;
+    std::cout << "       " << argv[0] << " blit check" << std::endl;
   }
   std::cout << "Done." << std::endl;
   return 0;
@@ -52,7 +176,7 @@ int main(int argc, char** argv) {
  * @return True if the app needs to exit, false otherwise.
  */
 bool Source_Process() {
-  clsh->Execute(20);
+  clsh->Execute_Slice();
   return false;
 }
 
@@ -85,6 +209,37 @@ namespace Codeloader {
     this->stack_pointer = 400;
     this->memory = NULL;
     this->status = eSTATUS_IDLE;
+    this->program_start = 0;
+    this->program_end = 0;
+    this->stack_start = 0;
+    this->stack_size = 0;
+    this->stack_cells = NULL;
+    this->pool_limit = 0;
+    this->slice_mode = eSLICE_TIME;
+    this->slice_budget = 20;
+    this->check_interval = 1;
+    this->sample_interval = 0;
+    this->sample_countdown = 0;
+    this->scratch.decoded = false;
+    std::fill(this->fusion_hits, this->fusion_hits + (eCODE_MULTI_POP - eCODE_VECTOR), 0);
+    this->native = NULL;
+    this->frame_display = NULL;
+    this->render_mode = eRENDER_PROCESSOR;
+    this->present_mode = ePRESENT_SYNC;
+    this->present_buffers = C_LESH_PRESENT_BUFFERS;
+    this->presenter = NULL;
+    this->frames = 0;
+    this->frame_bytes = 0;
+    this->uploaded_bytes = 0;
+#ifdef C_LESH_PROFILE
+    this->profiler = NULL;
+#endif
+#ifdef C_LESH_JIT
+    this->jit_code = new cCode_Buffer(C_LESH_JIT_CODE_SIZE);
+    this->jit_executed = 0;
+    this->jit_limit = 0;
+    this->jit_blocks = 0;
+#endif
     // Read the configuration file.
     std::ifstream config_file(config + ".txt");
     if (config_file) {
@@ -111,6 +266,66 @@ namespace Codeloader {
             else if (pair[0] == "stack") {
               this->stack_pointer = Text_To_Number(pair[1]);
             }
+            else if (pair[0] == "stack_size") {
+              this->stack_size = Text_To_Number(pair[1]);
+            }
+            else if (pair[0] == "slice") {
+              if (pair[1] == "time") {
+                this->slice_mode = eSLICE_TIME;
+              }
+              else if (pair[1] == "commands") {
+                this->slice_mode = eSLICE_COMMANDS;
+              }
+              else {
+                throw cError("Invalid slice mode " + pair[1] + ".");
+              }
+            }
+            else if (pair[0] == "budget") {
+              this->slice_budget = Text_To_Number(pair[1]);
+            }
+            else if (pair[0] == "render") {
+              if (pair[1] == "processor") {
+                this->render_mode = eRENDER_PROCESSOR;
+              }
+              else if (pair[1] == "frame") {
+                this->render_mode = eRENDER_FRAME;
+              }
+              else {
+                throw cError("Invalid render mode " + pair[1] + ".");
+              }
+            }
+            else if (pair[0] == "present") {
+              if (pair[1] == "sync") {
+                this->present_mode = ePRESENT_SYNC;
+              }
+              else if (pair[1] == "thread") {
+                this->present_mode = ePRESENT_THREAD;
+              }
+              else {
+                throw cError("Invalid present mode " + pair[1] + ".");
+              }
+            }
+            else if (pair[0] == "color") {
+              if (pair[1] == "full") {
+                this->frame.indexed = false;
+              }
+              else if (pair[1] == "indexed") {
+                this->frame.indexed = true;
+              }
+              else {
+                throw cError("Invalid color mode " + pair[1] + ".");
+              }
+            }
+            else if (pair[0] == "atlas") {
+              this->atlas.Load(pair[1] + ".txt");
+            }
+            else if (pair[0] == "buffers") {
+              this->present_buffers = Text_To_Number(pair[1]);
+            }
+            else if (pair[0] == "sample") {
+              this->sample_interval = Text_To_Number(pair[1]);
+              this->sample_countdown = this->sample_interval;
+            }
             else {
               throw cError("Invalid configuration property.");
             }
@@ -119,7 +334,35 @@ namespace Codeloader {
         }
       }
       // Apply settings.
+      if ((this->render_mode == eRENDER_FRAME) && io) {
+        this->frame_display = dynamic_cast<cFrame_Display*>(io);
+        if (!this->frame_display) {
+          throw cError("The display can not present frames.");
+        }
+        if ((this->present_mode == ePRESENT_THREAD) && !this->frame_display->Can_Present_On_Thread()) {
+          throw cError("The display can not present frames on another thread.");
+        }
+      }
+      if (io && (this->present_mode == ePRESENT_THREAD) && !this->frame_display) {
+        throw cError("Frames are only presented on a thread when rendering to a frame.");
+      }
+      if (this->frame_display && (this->atlas.height == 0)) {
+        this->frame_display->Bake_Atlas(this->atlas); // Text has to be drawn into the frame.
+      }
+      if (io && this->frame.indexed && !this->frame_display) {
+        throw cError("Indexed color needs rendering to a frame.");
+      }
       this->memory = new cMemory(memory_size, table_w, table_h);
+#ifdef C_LESH_PROFILE
+      this->profiler = new cProfiler(memory_size);
+      this->memory->profiler = this->profiler;
+#endif
+      this->program_start = this->command_pointer;
+      this->program_end = this->command_pointer;
+      this->stack_start = this->stack_pointer;
+      if (this->stack_size > 0) {
+        this->stack_cells = this->memory->Map_Stack(this->stack_start, this->stack_size);
+      }
     }
     else {
       throw cError("Could not load config file.");
@@ -130,862 +373,6007 @@ namespace Codeloader {
    * Frees up C-Lesh.
    */
   cC_Lesh::~cC_Lesh() {
+    this->Shutdown();
     if (this->memory) {
       delete this->memory;
     }
+#ifdef C_LESH_PROFILE
+    if (this->profiler) {
+      delete this->profiler;
+    }
+#endif
+#ifdef C_LESH_JIT
+    delete this->jit_code;
+#endif
   }
 
   /**
-   * Loads a program into C-Lesh.
+   * Loads a program into C-Lesh. A binary image of the program is used if there is one.
    * @param name The name of the program to load.
    * @throws An error if the program could not be loaded.
    */
   void cC_Lesh::Load_Program(std::string name) {
-    this->Load_Table_List(name + ".clshc", *(this->memory), this->command_pointer);
+    int count = 0;
+    this->program_name = name;
+    this->memory->Clear_Fault();
+#ifdef C_LESH_NATIVE
+    if (name == NATIVE_PROGRAM.name) {
+      this->Load_Native(NATIVE_PROGRAM);
+      return;
+    }
+#endif
+    std::ifstream image(name + ".clshb", std::ios::binary);
+    if (image) {
+      image.close();
+      count = this->memory->Load_Image(name + ".clshb", this->command_pointer);
+    }
+    else {
+      count = this->Load_Table_List(name + ".clshc", *(this->memory), this->command_pointer);
+    }
+    if (C_LESH_FAULTED()) {
+      throw this->Fault_Error(); // A table did not fit, e.g. over the stack.
+    }
+    this->program_start = this->command_pointer;
+    this->program_end = this->command_pointer + count;
+    this->Decode_Program();
+    this->Report_Diagnostics();
+    this->Load_Symbols(name + ".clshs");
+    this->Load_Pools(name + ".clshp");
     this->status = eSTATUS_RUNNING;
   }
 
   /**
-   * Executes a code.
-   * @param timeout The time slice to execute.
+   * Loads a program that was translated to C++. The tables of the program are copied
+   * into memory and decoded as usual so the interpreter can take over if the program
+   * changes its own commands.
+   * @param image The translated program.
+   * @throws An error if the program was translated for another address.
    */
-  void cC_Lesh::Execute(int timeout) {
-    std::clock_t start = std::clock();
-    while (this->status == eSTATUS_RUNNING) {
-      std::clock_t end = std::clock();
-      std::clock_t diff = (end - start) / CLOCKS_PER_SEC * 1000;
-      if ((int)diff >= timeout) { // Time up!
-        break;
+  void cC_Lesh::Load_Native(const sNative_Image& image) {
+    if (image.address != this->command_pointer) {
+      throw cError("Native program was translated for address " + Number_To_Text(image.address) + ".");
+    }
+    for (int table_index = 0; table_index < image.count; table_index++) {
+      const sImage_Entry& entry = image.entries[table_index];
+      if (!this->memory->Resize(image.address + table_index, entry.width, entry.height)) {
+        throw this->Fault_Error();
       }
-      else {
-        try {
-          this->Interpret();
+      sTable_Slot& table = (*this->memory)[image.address + table_index];
+      std::copy(image.cells + entry.offset, image.cells + entry.offset + (entry.width * entry.height), table.cells);
+      table.stamp++;
+    }
+    this->program_start = image.address;
+    this->program_end = image.address + image.count;
+    this->Decode_Program();
+    this->Report_Diagnostics();
+    this->Load_Symbols(this->program_name + ".clshs");
+    this->Load_Pools(this->program_name + ".clshp");
+    this->native = image.run;
+    this->status = eSTATUS_RUNNING;
+  }
+
+  /**
+   * Loads the object pools the compiler wrote for a program. Each line has the name of
+   * an object type, the offset of its first object from the start of the program, the
+   * number of objects, and the number of properties. The file is optional.
+   * @param name The name of the pool file.
+   * @throws An error if a pool does not fit the tables of the program.
+   */
+  void cC_Lesh::Load_Pools(std::string name) {
+    this->memory->Unmap_Pools();
+    std::ifstream pool_file(name.c_str());
+    while (pool_file) {
+      std::string line;
+      std::getline(pool_file, line);
+      cArray<std::string> pair = Parse_Sausage_Text(line, "=");
+      if (pair.Count() == 2) {
+        cArray<std::string> fields = Parse_Sausage_Text(pair[1], ",");
+        if (fields.Count() != 3) {
+          throw cError("Invalid pool " + pair[0] + " in " + name + ".");
         }
-        catch (cError error) {
-          this->status = eSTATUS_ERROR;
-          throw error; // Throw the error again!
+        int address = this->program_start + Text_To_Number(fields[0]);
+        int count = Text_To_Number(fields[1]);
+        int height = Text_To_Number(fields[2]);
+        if ((address < this->program_start) || (address + count > this->program_end)) {
+          throw cError("Pool " + pair[0] + " is not part of the program.");
+        }
+        this->memory->Map_Pool(address, count, height);
+      }
+    }
+  }
+
+  /**
+   * Executes the time or command slice set up in the configuration.
+   * @throws An error if a command fails.
+   */
+  void cC_Lesh::Execute_Slice() {
+    if (this->slice_mode == eSLICE_COMMANDS) {
+      this->Execute_Commands(this->slice_budget);
+    }
+    else {
+      this->Execute(this->slice_budget);
+    }
+  }
+
+  /**
+   * Executes a code. The clock is only read between runs of commands and the length
+   * of a run is tuned so the clock is read about every C_LESH_CHECK_MICROSECONDS.
+   * @param timeout The time slice to execute in milliseconds.
+   * @throws An error if a command fails.
+   */
+  void cC_Lesh::Execute(int timeout) {
+    std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point end = last + std::chrono::milliseconds(timeout);
+    try {
+      while (this->status == eSTATUS_RUNNING) {
+        this->Dispatch(this->check_interval);
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        long long elapsed = (long long)std::chrono::duration_cast<std::chrono::microseconds>(now - last).count();
+        if ((elapsed < C_LESH_CHECK_MICROSECONDS / 2) && (this->check_interval < C_LESH_MAX_CHECK_INTERVAL)) {
+          this->check_interval *= 2;
+        }
+        else if ((elapsed > C_LESH_CHECK_MICROSECONDS * 2) && (this->check_interval > 1)) {
+          this->check_interval /= 2;
+        }
+        last = now;
+        if (now >= end) { // Time up!
+          break;
+        }
+      }
+    }
+    catch (cError error) {
+      this->status = eSTATUS_ERROR;
+      throw error; // Throw the error again!
+    }
+  }
+
+  /**
+   * Executes a fixed number of commands.
+   * @param count The number of commands to execute.
+   * @throws An error if a command fails.
+   */
+  void cC_Lesh::Execute_Commands(int count) {
+    try {
+      while ((this->status == eSTATUS_RUNNING) && (count > 0)) {
+        count -= this->Dispatch(count);
+      }
+    }
+    catch (cError error) {
+      this->status = eSTATUS_ERROR;
+      throw error; // Throw the error again!
+    }
+  }
+
+  /**
+   * Runs commands with the dispatch engine selected at build time. When sampling is on
+   * the run ends early so the call stack can be sampled on time.
+   * @param count The maximum number of commands to run.
+   * @return The number of commands that were run.
+   * @throws An error if a command is invalid.
+   */
+  int cC_Lesh::Dispatch(int count) {
+    if (this->sample_interval > 0) {
+      count = std::min(count, this->sample_countdown);
+    }
+    int executed = 0;
+    while ((executed < count) && (this->status == eSTATUS_RUNNING)) {
+      int batch = count - executed;
+      if (this->native) {
+        executed += this->native(*this, batch);
+        if (C_LESH_FAULTED()) {
+          break;
         }
+        batch = std::min(1, count - executed); // The command the native program could not run.
+      }
+#ifdef C_LESH_THREADED_DISPATCH
+      executed += this->Run(batch);
+#else
+      int ran = 0;
+      while ((ran < batch) && (this->status == eSTATUS_RUNNING)) {
+        ran += this->Interpret(batch - ran);
+      }
+      executed += ran;
+#endif
+    }
+    if (C_LESH_FAULTED()) {
+      throw this->Fault_Error(); // Faults become errors here, outside of the dispatch loop.
+    }
+    if (this->sample_interval > 0) {
+      this->sample_countdown -= executed;
+      if (this->sample_countdown <= 0) {
+        this->Sample_Stack();
+        this->sample_countdown = this->sample_interval;
       }
     }
+    return executed;
   }
 
   /**
-   * Interprets a single command.
+   * Interprets a single command. A fused command runs the commands it was fused from.
+   * @param limit The maximum number of commands a fused command may run.
+   * @return The number of commands that were run.
    * @throws An error if the command is invalid.
    */
-  void cC_Lesh::Interpret() {
-    cTable& command = (*this->memory)[this->command_pointer++]; // Had to dereference!
-    command.Rewind(); // Rewind so the command can be executed again.
-    int code = command.Read_Column();
-    command.Move_To_Next_Row();
-    switch (code) { // Command is at origin.
+  int cC_Lesh::Interpret(int limit) {
+    int address = this->command_pointer;
+    int ran = 1;
+    sInstruction& instruction = this->Fetch(this->command_pointer++);
+    C_LESH_PROFILE_COMMAND(address, instruction.code);
+    switch (instruction.code) {
       case eCODE_STORE: {
-        this->Store(command);
+        this->Store(instruction);
         break;
       }
       case eCODE_DUMP: {
-        this->Dump(command);
+        this->Dump(instruction);
         break;
       }
       case eCODE_TEST: {
-        this->Test(command);
+        this->Test(instruction);
         break;
       }
       case eCODE_JUMP: {
-        this->Jump(command);
+        this->Jump(instruction);
         break;
       }
       case eCODE_CALL: {
-        this->Call(command);
+        this->Call(instruction);
         break;
       }
       case eCODE_RETURN: {
-        this->Return(command);
+        this->Return(instruction);
         break;
       }
       case eCODE_PUSH: {
-        this->Push(command);
+        this->Push(instruction);
         break;
       }
       case eCODE_POP: {
-        this->Pop(command);
+        this->Pop(instruction);
         break;
       }
       case eCODE_LOAD: {
-        this->Load(command);
+        this->Load(instruction);
         break;
       }
       case eCODE_SAVE: {
-        this->Save(command);
+        this->Save(instruction);
         break;
       }
       case eCODE_INPUT: {
-        this->Input(command);
+        this->Input(instruction);
         break;
       }
       case eCODE_REFRESH: {
-        this->Refresh(command);
+        this->Refresh(instruction);
         break;
       }
       case eCODE_SOUND: {
-        this->Sound(command);
+        this->Sound(instruction);
         break;
       }
       case eCODE_TIMEOUT: {
-        this->Timeout(command);
+        this->Timeout(instruction);
         break;
       }
       case eCODE_OUTPUT: {
-        this->Output(command);
+        this->Output(instruction);
         break;
       }
       case eCODE_STRING: {
-        this->String(command);
+        this->String(instruction);
         break;
       }
       case eCODE_PALETTE: {
-        this->Palette(command);
+        this->Palette(instruction);
         break;
       }
       case eCODE_DRAW: {
-        this->Draw(command);
+        this->Draw(instruction);
         break;
       }
       case eCODE_CLEAR: {
-        this->Clear(command);
+        this->Clear(instruction);
         break;
       }
       case eCODE_RESIZE: {
-        this->Resize(command);
+        this->Resize(instruction);
         break;
       }
       case eCODE_COLUMN: {
-        this->Column(command);
+        this->Column(instruction);
         break;
       }
       case eCODE_STOP: {
-        this->Stop(command);
-        break;
-      }
-      default: {
-        throw cError("Invalid command " + Number_To_Text(code) + ".");
-      }
-    }
-  }
-
-  /**
-   * Evaluates an expression and returns a number.
-   * @param command The command where the expression is.
-   * @return The result of the evaluation.
-   * @throws An error if the operator is invalid.
-   */
-  int cC_Lesh::Eval_Expression(cTable& command) {
-    int result = this->Eval_Operand(command);
-    int op = command.Read_Column();
-    while (op != eOPERATOR_NONE) {
-      int operand_result = this->Eval_Operand(command);
-      switch (op) {
-        case eOPERATOR_ADD: {
-          result += operand_result;
-          break;
-        }
-        case eOPERATOR_SUBTRACT: {
-          result -= operand_result;
-          break;
-        }
-        case eOPERATOR_MULTIPLY: {
-          result *= operand_result;
-          break;
-        }
-        case eOPERATOR_DIVIDE: {
-          if (operand_result != 0) {
-            result /= operand_result;
-          }
-          break;
-        }
-        case eOPERATOR_REMAINDER: {
-          if (operand_result == 0) {
-            result = 0;
-          }
-          else {
-            result %= operand_result;
-          }
-          break;
-        }
-        case eOPERATOR_RANDOM: {
-          result = this->io->Get_Random_Number(result, operand_result);
-          break;
-        }
-        case eOPERATOR_COSINE: {
-          result = (int)((double)result * std::cos((double)operand_result * 3.15 / 180.0));
-          break;
-        }
-        case eOPERATOR_SINE: {
-          result = (int)((double)result * std::sin((double)operand_result * 3.15 / 180.0));
-          break;
-        }
-        case eOPERATOR_NONE: {
-          break; // Do nothing.
-        }
-        default: {
-          throw cError("Invalid operator " + Number_To_Text(op) + ".");
-        }
-      }
-      op = command.Read_Column();
-    }
-    command.Move_To_Next_Row();
-    return result;
-  }
-
-  /**
-   * Evaluates an operand.
-   * @param command The command where the operand is in.
-   * @return The result of the operand.
-   * @throws An error if the addressing mode is invalid.
-   */
-  int cC_Lesh::Eval_Operand(cTable& command) {
-    int mode = command.Read_Column();
-    int result = 0;
-    switch (mode) {
-      case eADDRESS_VALUE: {
-        result = command.Read_Column();
+        this->Stop(instruction);
         break;
       }
-      case eADDRESS_IMMEDIATE: {
-        int address = command.Read_Column();
-        cTable& value = this->Get_Table_At_Immediate_Address(address);
-        result = value.Read_Column();
+      case eCODE_COPY: {
+        this->Copy(instruction);
         break;
       }
-      case eADDRESS_POINTER: {
-        int address = command.Read_Column();
-        cTable& value = this->Get_Table_At_Pointer(address);
-        result = value.Read_Column();
+      case eCODE_BLOCK: {
+        this->Block(instruction);
         break;
       }
-      case eADDRESS_STACK: {
-        int address = command.Read_Column();
-        cTable& value = this->Get_Table_At_Stack(address);
-        result = value.Read_Column();
+      case eCODE_FILL: {
+        this->Fill(instruction);
         break;
       }
-      case eADDRESS_OBJECT_IMMEDIATE: {
-        int address = command.Read_Column();
-        int prop_index = command.Read_Column();
-        cTable& value = this->Get_Object_At_Immediate_Address(address, prop_index);
-        result = value.Read_Column();
+      case eCODE_VECTOR: {
+        this->Vector(instruction);
         break;
       }
-      case eADDRESS_OBJECT_POINTER: {
-        int address = command.Read_Column();
-        int prop_index = command.Read_Column();
-        cTable& value = this->Get_Object_At_Pointer(address, prop_index);
-        result = value.Read_Column();
+      case eCODE_INCREMENT_TEST:
+      case eCODE_PUSH_CALL:
+      case eCODE_MULTI_POP: {
+        ran = this->Run_Fused(instruction, limit);
         break;
       }
       default: {
-        throw cError("Invalid address mode " + Number_To_Text(mode) + ".");
+        throw cError("Invalid command " + Number_To_Text(instruction.code) + ".");
       }
     }
-    return result;
-  }
-
-  /**
-   * Evaluates a conditional expression.
-   * @param command The command containing the conditional expression.
-   * @return The result of the conditional.
-   * @throws An error if the logic operator is invalid.
-   */
-  int cC_Lesh::Eval_Conditional(cTable& command) {
-    int result = this->Eval_Condition(command);
-    int logic_operator = command.Read_Column(); // One operator per row.
-    command.Move_To_Next_Row();
-    while (logic_operator != eLOGIC_NONE) {
-      int cond_result = this->Eval_Condition(command);
-      switch (logic_operator) {
-        case eLOGIC_AND: {
-          result *= cond_result; // Multiply for AND.
-          break;
-        }
-        case eLOGIC_OR: {
-          result += cond_result; // Add for OR.
-          break;
-        }
-        case eLOGIC_NONE: {
-          break; // Do nothing.
-        }
-      }
-      logic_operator = command.Read_Column();
-      command.Move_To_Next_Row();
+    if (C_LESH_FAULTED()) {
+      this->Record_Fault(address);
     }
-    return result;
+    C_LESH_PROFILE_END();
+    return ran;
   }
 
+  typedef void (cC_Lesh::*tHandler)(sInstruction& instruction);
+
+  // Handlers of every command a program can use. Fused commands go through Run_Fused().
+  static const tHandler HANDLERS[] = {
+    &cC_Lesh::Store, &cC_Lesh::Dump, &cC_Lesh::Test, &cC_Lesh::Jump, &cC_Lesh::Call,
+    &cC_Lesh::Return, &cC_Lesh::Push, &cC_Lesh::Pop, &cC_Lesh::Load, &cC_Lesh::Save,
+    &cC_Lesh::Input, &cC_Lesh::Refresh, &cC_Lesh::Sound, &cC_Lesh::Timeout, &cC_Lesh::Output,
+    &cC_Lesh::String, &cC_Lesh::Palette, &cC_Lesh::Draw, &cC_Lesh::Clear, &cC_Lesh::Resize,
+    &cC_Lesh::Column, &cC_Lesh::Stop, &cC_Lesh::Copy, &cC_Lesh::Block, &cC_Lesh::Fill,
+    &cC_Lesh::Vector
+  };
+
   /**
-   * Evaluates a condition.
-   * @param command The command containing the condition.
-   * @return The result of the condition test.
-   * @throws An error if the test is invalid.
+   * Runs commands with threaded dispatch. Every handler jumps straight to the handler
+   * of the next command instead of returning to Execute after each command. Compilers
+   * without computed goto call the handlers through a table instead.
+   * @param count The maximum number of commands to run.
+   * @return The number of commands that were run.
+   * @throws An error if a command is invalid.
    */
-  int cC_Lesh::Eval_Condition(cTable& command) {
-    int result = 0;
-    int left_operand = this->Eval_Expression(command);
-    int test = command.Read_Column(); // Test is on single row.
-    command.Move_To_Next_Row();
-    int right_operand = this->Eval_Expression(command);
-    int diff = right_operand - left_operand;
-    switch (test) {
-      case eTEST_EQUALS: {
-        result = (diff == 0);
-        break;
-      }
-      case eTEST_NOT: {
-        result = (diff != 0);
-        break;
-      }
-      case eTEST_LESS: {
-        result = (diff < 0);
-        break;
-      }
-      case eTEST_GREATER: {
-        result = (diff > 0);
-        break;
-      }
-      case eTEST_LESS_OR_EQUAL: {
-        result = (diff <= 0);
-        break;
+  int cC_Lesh::Run(int count) {
+    int executed = 0;
+    int address = this->command_pointer;
+    sInstruction* instruction = NULL;
+#if defined(__GNUC__)
+    static void* handlers[] = {
+      &&op_store, &&op_dump, &&op_test, &&op_jump, &&op_call, &&op_return, &&op_push,
+      &&op_pop, &&op_load, &&op_save, &&op_input, &&op_refresh, &&op_sound, &&op_timeout,
+      &&op_output, &&op_string, &&op_palette, &&op_draw, &&op_clear, &&op_resize,
+      &&op_column, &&op_stop, &&op_copy, &&op_block, &&op_fill, &&op_vector, &&op_fused,
+      &&op_fused, &&op_fused
+    };
+    // Decoded instructions always have a valid code so the table can be indexed directly.
+    #define C_LESH_NEXT() \
+      if ((executed >= count) || C_LESH_FAULTED()) { \
+        goto finish; \
+      } \
+      C_LESH_JIT_ENTER(); \
+      address = this->command_pointer; \
+      instruction = &this->Fetch(this->command_pointer++); \
+      C_LESH_PROFILE_COMMAND(address, instruction->code); \
+      executed++; \
+      goto *handlers[instruction->code]
+    if (this->status != eSTATUS_RUNNING) {
+      return 0;
+    }
+    C_LESH_NEXT();
+    op_store: this->Store(*instruction); C_LESH_NEXT();
+    op_dump: this->Dump(*instruction); C_LESH_NEXT();
+    op_test: this->Test(*instruction); C_LESH_NEXT();
+    op_jump: this->Jump(*instruction); C_LESH_NEXT();
+    op_call: this->Call(*instruction); C_LESH_NEXT();
+    op_return: this->Return(*instruction); C_LESH_NEXT();
+    op_push: this->Push(*instruction); C_LESH_NEXT();
+    op_pop: this->Pop(*instruction); C_LESH_NEXT();
+    op_load: this->Load(*instruction); C_LESH_NEXT();
+    op_save: this->Save(*instruction); C_LESH_NEXT();
+    op_input: this->Input(*instruction); C_LESH_NEXT();
+    op_refresh: this->Refresh(*instruction); C_LESH_NEXT();
+    op_sound: this->Sound(*instruction); C_LESH_NEXT();
+    op_timeout: this->Timeout(*instruction); C_LESH_NEXT();
+    op_output: this->Output(*instruction); C_LESH_NEXT();
+    op_string: this->String(*instruction); C_LESH_NEXT();
+    op_palette: this->Palette(*instruction); C_LESH_NEXT();
+    op_draw: this->Draw(*instruction); C_LESH_NEXT();
+    op_clear: this->Clear(*instruction); C_LESH_NEXT();
+    op_resize: this->Resize(*instruction); C_LESH_NEXT();
+    op_column: this->Column(*instruction); C_LESH_NEXT();
+    op_copy: this->Copy(*instruction); C_LESH_NEXT();
+    op_block: this->Block(*instruction); C_LESH_NEXT();
+    op_fill: this->Fill(*instruction); C_LESH_NEXT();
+    op_vector: this->Vector(*instruction); C_LESH_NEXT();
+    op_fused: executed += this->Run_Fused(*instruction, count - executed + 1) - 1; C_LESH_NEXT();
+    op_stop: this->Stop(*instruction); goto finish; // Only stop changes the status.
+    finish:
+    C_LESH_PROFILE_END();
+    if (C_LESH_FAULTED()) {
+      this->Record_Fault(address);
+    }
+    return executed;
+    #undef C_LESH_NEXT
+#else
+    while ((executed < count) && (this->status == eSTATUS_RUNNING)) {
+      C_LESH_JIT_ENTER();
+      address = this->command_pointer;
+      instruction = &this->Fetch(this->command_pointer++);
+      C_LESH_PROFILE_COMMAND(address, instruction->code);
+      executed++;
+      if (instruction->code > eCODE_VECTOR) {
+        executed += this->Run_Fused(*instruction, count - executed + 1) - 1;
       }
-      case eTEST_GREATER_OR_EQUAL: {
-        result = (diff >= 0);
-        break;
+      else {
+        (this->*HANDLERS[instruction->code])(*instruction);
       }
-      default: {
-        throw cError("Invalid test operator " + Number_To_Text(test) + ".");
+      if (C_LESH_FAULTED()) {
+        this->Record_Fault(address);
       }
     }
-    return result;
-  }
-
-  /**
-   * Gets a table at an immediate address.
-   * @param address The address where the table is.
-   * @return The table reference.
-   */
-  cTable& cC_Lesh::Get_Table_At_Immediate_Address(int address) {
-    cTable& table = (*this->memory)[address];
-    table.Rewind(); // Rewind to get origin column.
-    return table;
+    C_LESH_PROFILE_END();
+    return executed;
+#endif
   }
 
   /**
-   * Gets a table at a pointer.
-   * @param address The address of the pointer.
-   * @return The table reference.
+   * Resets the memory and pointers so a program can be loaded again.
    */
-  cTable& cC_Lesh::Get_Table_At_Pointer(int address) {
-    cTable& pointer = (*this->memory)[address];
-    pointer.Rewind();
-    int ptr_value = pointer.Read_Column();
-    cTable& table = (*this->memory)[ptr_value];
-    table.Rewind();
-    return table;
+  void cC_Lesh::Reset() {
+    this->memory->Clear();
+    this->command_pointer = this->program_start;
+    this->stack_pointer = this->stack_start;
+    this->program_end = this->program_start;
+    this->instructions.clear();
+    this->samples.clear();
+    this->sample_countdown = this->sample_interval;
+    std::fill(this->fusion_hits, this->fusion_hits + (eCODE_MULTI_POP - eCODE_VECTOR), 0);
+    this->status = eSTATUS_IDLE;
+    this->native = NULL;
+    this->verified_rows.clear();
+    this->memory->Clear_Fault();
+    this->damage.Add_Screen();
+    this->frames = 0;
+    this->frame_bytes = 0;
+    this->uploaded_bytes = 0;
+    this->text_cache.Clear();
+#ifdef C_LESH_PROFILE
+    this->profiler->Reset();
+#endif
   }
 
   /**
-   * Gets a table at a stack location.
-   * @param The address of the table on the stack. These addresses are reversed an 1-based.
-   * @return The table reference.
+   * Sets the size of the screen so drawing can be tracked. Until the size is known every
+   * refresh presents the whole screen.
+   * @param width The width of the screen in pixels.
+   * @param height The height of the screen in pixels.
    */
-  cTable& cC_Lesh::Get_Table_At_Stack(int address) {
-    int stack_address = this->stack_pointer - address; // Access variables in reverse.
-    cTable& table = (*this->memory)[stack_address];
-    table.Rewind();
-    return table;
+  void cC_Lesh::Set_Screen_Size(int width, int height) {
+    this->damage.Set_Screen(width, height);
+    this->frame.Resize(width, height);
+    if (this->presenter) {
+      delete this->presenter;
+      this->presenter = NULL;
+    }
+    if (this->frame_display && (this->present_mode == ePRESENT_THREAD)) {
+      this->presenter = new cPresenter(this->frame_display, width, height, this->present_buffers);
+    }
   }
 
   /**
-   * Gets an object at an immediate address. The object property value can then be read or written.
-   * @param address The address of the object.
-   * @param prop_index The index of the property to read or written.
-   * @return A reference to the table containing the object.
+   * Presents the frames that are still queued and stops the present thread. This has
+   * to happen before the display goes away.
    */
-  cTable& cC_Lesh::Get_Object_At_Immediate_Address(int address, int prop_index) {
-    cTable& object = (*this->memory)[address];
-    object.Rewind(); // Rewind to get origin column.
-    object.Move_To_Row(prop_index); // Move to row where property is.
-    return object;
+  void cC_Lesh::Shutdown() {
+    if (this->presenter) {
+      this->presenter->Finish();
+      delete this->presenter;
+      this->presenter = NULL;
+    }
   }
 
   /**
-   * Gets an object at a pointer.
-   * @param address The address of the pointer.
-   * @param prop_index The index of the property to be read or written.
-   * @return A reference to the table containing the object.
+   * Runs a program to completion with the switch and the threaded dispatch engines
+   * and prints the commands per second of each. The error mode is printed first so
+   * builds with and without C_LESH_FAULT_CODES can be compared.
+   * @param name The name of the program.
+   * @throws An error if the program could not be loaded or fails.
    */
-  cTable& cC_Lesh::Get_Object_At_Pointer(int address, int prop_index) {
-    cTable& pointer = (*this->memory)[address];
-    pointer.Rewind();
-    int ptr_value = pointer.Read_Column();
-    cTable& object = (*this->memory)[ptr_value];
-    object.Rewind();
-    object.Move_To_Row(prop_index);
-    return object;
-  }
-
-  /**
-   * Gets the table at an address given the mode.
-   * @param command The command to get the address meta data from.
-   * @throws An error if the mode is invalid.
+  void cC_Lesh::Benchmark_Dispatch(std::string name) {
+#ifdef C_LESH_FAULT_CODES
+    std::cout << "errors: fault codes" << std::endl;
+#else
+    std::cout << "errors: exceptions" << std::endl;
+#endif
+    for (int engine = 0; engine < 2; engine++) {
+      this->Reset();
+      this->Load_Program(name);
+      long long executed = 0;
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      try {
+        if (engine == 0) {
+          while (this->status == eSTATUS_RUNNING) {
+            executed += this->Interpret(C_LESH_DISPATCH_BATCH);
+          }
+        }
+        else {
+          while (this->status == eSTATUS_RUNNING) {
+            executed += this->Run(C_LESH_DISPATCH_BATCH);
+          }
+        }
+        if (C_LESH_FAULTED()) {
+          throw this->Fault_Error();
+        }
+      }
+      catch (cError error) {
+        this->status = eSTATUS_ERROR;
+        this->Shutdown();
+        throw error;
+      }
+      if (this->presenter) {
+        this->presenter->Finish(); // Frames of one engine are not left to the next.
+      }
+      this->Report_Speed((engine == 0) ? "switch" : "threaded", executed, start);
+    }
+  }
+
+  /**
+   * Creates memories of different sizes and prints how long each took to create and
+   * how much resident memory it took, before and after writing to every hundredth
+   * table.
+   * @param width The width of each table.
+   * @param height The height of each table.
+   * @param counts The numbers of tables to try.
+   * @throws An error if a memory could not be created.
    */
-  cTable& cC_Lesh::Get_Table_At_Address(cTable& command) {
-    // Read meta data row.
-    int mode = command.Read_Column();
-    int address = command.Read_Column();
-    command.Move_To_Next_Row();
-    switch (mode) {
+  void cC_Lesh::Benchmark_Startup(int width, int height, std::vector<int>& counts) {
+    for (size_t count_index = 0; count_index < counts.size(); count_index++) {
+      int count = counts[count_index];
+      long long base = Resident_Memory();
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      cMemory* memory = new cMemory(count, width, height);
+      double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      long long created = Resident_Memory();
+      for (int table_index = 0; table_index < count; table_index += 100) {
+        memory->Write_Scalar(table_index, 1);
+      }
+      long long touched = Resident_Memory();
+      delete memory;
+      std::cout << "memory=" << count << " (" << width << "x" << height << "): startup " << elapsed << " ms, resident " <<
+        ((created - base) / 1024) << " KB, " << ((touched - base) / 1024) << " KB after writing 1% of tables" << std::endl;
+    }
+  }
+
+  /**
+   * Gets the resident memory of the process.
+   * @return The resident memory in bytes or 0 if it is not known.
+   */
+  long long cC_Lesh::Resident_Memory() {
+    long long resident = 0;
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+      resident = (long long)counters.WorkingSetSize;
+    }
+#elif defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    long long size = 0;
+    long long pages = 0;
+    if (statm >> size >> pages) {
+      resident = pages * (long long)sysconf(_SC_PAGESIZE);
+    }
+#endif
+    return resident;
+  }
+
+  /**
+   * Runs a program until it stops, as fast as possible, and prints the wall time, the
+   * number of commands run and the commands per second.
+   * @param name The name of the program.
+   * @throws An error if the program could not be loaded or fails.
+   */
+  void cC_Lesh::Run_Batch(std::string name) {
+    this->Load_Program(name);
+    long long executed = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    try {
+      while (this->status == eSTATUS_RUNNING) {
+        executed += this->Dispatch(C_LESH_DISPATCH_BATCH);
+      }
+    }
+    catch (cError error) {
+      this->status = eSTATUS_ERROR;
+      this->Shutdown();
+      this->Report_Speed("batch", executed, start);
+      throw error;
+    }
+    this->Report_Speed("batch", executed, start);
+    this->Report_Fusions();
+    if (this->presenter) {
+      this->presenter->Finish();
+      std::cout << "present: " << this->presenter->presented << " frames presented, " << this->presenter->dropped << " dropped, latency " <<
+        (this->presenter->total_latency / std::max(this->presenter->presented, 1LL)) << " ms average, " << this->presenter->max_latency << " ms max" << std::endl;
+    }
+    if ((this->text_cache.hits + this->text_cache.misses) > 0) {
+      std::cout << "text: " << this->text_cache.hits << " hits, " << this->text_cache.misses << " misses, " <<
+        this->text_cache.images.size() << " cached" << std::endl;
+    }
+    if (this->frames > 0) {
+      std::cout << "display: " << this->frames << " frames, " << this->uploaded_bytes << " bytes uploaded (" <<
+        (this->uploaded_bytes / this->frames) << " per frame)" << std::endl;
+    }
+#ifdef C_LESH_JIT
+    std::cout << "jit: " << this->jit_blocks << " blocks compiled" << std::endl;
+#endif
+  }
+
+  /**
+   * Prints how fast a number of commands ran.
+   * @param label The label of the run.
+   * @param executed The number of commands that were run.
+   * @param start The time the run started.
+   */
+  void cC_Lesh::Report_Speed(std::string label, long long executed, std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double seconds = std::max(elapsed.count(), 1e-9);
+    std::cout << label << ": " << executed << " commands in " << (seconds * 1000.0) << " ms (" <<
+      (long long)((double)executed / seconds) << " commands/s)" << std::endl;
+  }
+
+  /**
+   * Prints how many times each kind of fused command ran all the way through.
+   */
+  void cC_Lesh::Report_Fusions() {
+    for (int fusion_index = 0; fusion_index < (eCODE_MULTI_POP - eCODE_VECTOR); fusion_index++) {
+      static const char* names[] = { "increment_test", "push_call", "multi_pop" };
+      std::cout << "fusion " << names[fusion_index] << ": " << this->fusion_hits[fusion_index] << " hits" << std::endl;
+    }
+  }
+
+  /**
+   * Writes the profile gathered so far as a sorted report, a CSV file and a JSON file.
+   * Nothing is written unless C-Lesh was built with C_LESH_PROFILE.
+   * @param name The name the files are based on.
+   * @throws An error if the profile could not be written.
+   */
+  void cC_Lesh::Write_Profile(std::string name) {
+#ifdef C_LESH_PROFILE
+    this->profiler->End_Command();
+    this->profiler->Write_Report(name + "_Profile.txt");
+    this->profiler->Write_Csv(name + "_Profile.csv");
+    this->profiler->Write_Json(name + "_Profile.json");
+#endif
+  }
+
+  /**
+   * Writes the state of memory so runs of the same program can be compared. The first
+   * line has the status, command pointer and stack pointer. Each table that is not an
+   * empty 1x1 table follows on its own line with its address, size and cells.
+   * @param name The name of the dump file.
+   * @throws An error if the dump could not be written.
+   */
+  void cC_Lesh::Dump_Memory(std::string name) {
+    std::ofstream dump(name.c_str());
+    if (!dump) {
+      throw cError("Could not write dump " + name + ".");
+    }
+    dump << "status=" << this->status << " command=" << this->command_pointer << " stack=" << this->stack_pointer << std::endl;
+    for (int address = 0; address < this->memory->count; address++) {
+      sTable_Slot& slot = (*this->memory)[address];
+      bool empty = (slot.width == 1) && (slot.height == 1) && (slot.cells[0] == 0);
+      if (!empty) {
+        dump << address << ": " << slot.width << "x" << slot.height;
+        for (int row = 0; row < slot.height; row++) {
+          for (int col = 0; col < slot.width; col++) {
+            dump << " " << slot.cells[(row * slot.stride) + col];
+          }
+        }
+        dump << std::endl;
+      }
+    }
+  }
+
+  // **************************************************************************
+  // Call Stack Sampler
+  // **************************************************************************
+
+  /**
+   * Loads the labels the compiler wrote for a program. Each line has a label and the
+   * offset of the label from the start of the program. The file is optional.
+   * @param name The name of the symbol file.
+   */
+  void cC_Lesh::Load_Symbols(std::string name) {
+    this->symbols.clear();
+    std::ifstream symbol_file(name.c_str());
+    while (symbol_file) {
+      std::string line;
+      std::getline(symbol_file, line);
+      cArray<std::string> pair = Parse_Sausage_Text(line, "=");
+      if (pair.Count() == 2) {
+        this->symbols[this->program_start + Text_To_Number(pair[1])] = pair[0];
+      }
+    }
+  }
+
+  /**
+   * Samples the call stack. Values on the stack are return addresses when the table
+   * before them is a call command. The folded stack goes from the outermost caller to
+   * the command that is about to run.
+   */
+  void cC_Lesh::Sample_Stack() {
+    std::string stack = "";
+    int location = this->command_pointer;
+    int entry = -1;
+    int top = std::min(this->stack_pointer, this->memory->count);
+    for (int stack_index = std::max(this->stack_start, 0); stack_index < top; stack_index++) {
+      int return_address = this->memory->Slot(stack_index).cells[0];
+      if ((return_address > 0) && (return_address <= this->memory->count) &&
+        (this->memory->Slot(return_address - 1).cells[0] == eCODE_CALL)) {
+        if (stack.length() > 0) {
+          stack += ";";
+        }
+        stack += this->Symbol_Name(return_address - 1, entry);
+        entry = -1;
+        try {
+          sInstruction& call = this->Fetch(return_address - 1);
+          sTerm& target = this->terms[call.exprs[0].start];
+          if ((call.exprs[0].count == 1) && (target.operand.mode == eADDRESS_VALUE)) {
+            entry = target.operand.address; // Only calls to a fixed address are known.
+          }
+        }
+        catch (cError error) {
+          // Not a call after all.
+        }
+      }
+    }
+    if (stack.length() > 0) {
+      stack += ";";
+    }
+    stack += this->Symbol_Name(location, entry);
+    this->samples[stack]++;
+  }
+
+  /**
+   * Names the subroutine a command belongs to. The closest label at or before the
+   * command is used. Without labels subroutines are named by their entry address.
+   * @param address The address of the command.
+   * @param entry The entry address of the subroutine or -1 for the program itself.
+   * @return The name of the subroutine.
+   */
+  std::string cC_Lesh::Symbol_Name(int address, int entry) {
+    std::string name = this->program_name;
+    if (this->symbols.size() > 0) {
+      std::map<int, std::string>::iterator symbol = this->symbols.upper_bound(address);
+      if (symbol != this->symbols.begin()) {
+        name = (--symbol)->second;
+      }
+    }
+    else if (entry >= 0) {
+      name = "sub_" + Number_To_Text(entry);
+    }
+    return name;
+  }
+
+  /**
+   * Writes the sampled call stacks as folded stacks. Every line has the frames separated
+   * by semicolons followed by the number of samples, which flame graph tools read.
+   * @param name The name the stack file is based on.
+   * @throws An error if the file could not be written.
+   */
+  void cC_Lesh::Write_Stacks(std::string name) {
+    std::ofstream stacks((name + "_Stacks.txt").c_str());
+    if (!stacks) {
+      throw cError("Could not write stacks of " + name + ".");
+    }
+    for (std::map<std::string, long long>::iterator sample = this->samples.begin(); sample != this->samples.end(); ++sample) {
+      stacks << sample->first << " " << sample->second << std::endl;
+    }
+  }
+
+  // **************************************************************************
+  // Decoder
+  // **************************************************************************
+
+  // Operand layout of each command: r = table reference, e = expression, c = conditional.
+  static const char* LAYOUTS[] = {
+    "re",     // Store
+    "",       // Dump
+    "cee",    // Test
+    "e",      // Jump
+    "e",      // Call
+    "",       // Return
+    "e",      // Push
+    "r",      // Pop
+    "ree",    // Load
+    "rr",     // Save
+    "r",      // Input
+    "",       // Refresh
+    "r",      // Sound
+    "e",      // Timeout
+    "reeeee", // Output
+    "rrr",    // String
+    "r",      // Palette
+    "reee",   // Draw
+    "eee",    // Clear
+    "ree",    // Resize
+    "rer",    // Column
+    "",       // Stop
+    "rre",    // Copy
+    "reereeee", // Block
+    "ree",    // Fill
+    "rrer"    // Vector
+  };
+
+  /**
+   * Decodes every command in the program region into the instruction stream. Tables
+   * that are not commands (numbers, strings, matrices) are left undecoded and only
+   * raise an error if they are ever executed.
+   */
+  void cC_Lesh::Decode_Program() {
+    int count = this->program_end - this->program_start;
+    this->instructions.assign(count, sInstruction());
+    this->terms.clear();
+    this->conditions.clear();
+    for (int instr_index = 0; instr_index < count; instr_index++) {
+      try {
+        this->Decode_Instruction(this->program_start + instr_index, this->instructions[instr_index]);
+      }
+      catch (cError error) {
+        // Not a command. Leave it undecoded.
+      }
+    }
+    this->Verify_Program();
+    // Let stale decodes pile up to twice the program size before reclaiming them.
+    this->pool_limit = (int)this->terms.size() * 2 + 4096;
+    this->Fuse_Range(this->program_start, this->program_end);
+#ifdef C_LESH_JIT
+    this->jit_entries.assign(count, NULL);
+    this->jit_lengths.assign(count, 0);
+    this->jit_heat.assign(count, 0);
+    this->jit_covered.assign(count, 0);
+    this->Flush_Jit();
+#endif
+  }
+
+  /**
+   * Re-decodes a range of tables after they were overwritten. Only the part of the
+   * range inside the program region is decoded.
+   * @param address The address of the first table.
+   * @param count The number of tables.
+   */
+  void cC_Lesh::Decode_Range(int address, int count) {
+    if ((int)this->terms.size() > this->pool_limit) {
+      this->Decode_Program();
+    }
+    else {
+#ifdef C_LESH_JIT
+      this->Flush_Jit();
+#endif
+      this->native = NULL; // The translated commands may be stale.
+      int start = std::max(address, this->program_start);
+      int end = std::min(address + count, this->program_end);
+      for (int instr_address = start; instr_address < end; instr_address++) {
+        sInstruction& instruction = this->instructions[instr_address - this->program_start];
+        try {
+          this->Decode_Instruction(instr_address, instruction);
+        }
+        catch (cError error) {
+          // Not a command. Leave it undecoded.
+        }
+      }
+      this->Verify_Range(start, end);
+      this->Fuse_Range(std::max(start - 1, this->program_start), end); // The command before may fuse with the range.
+    }
+  }
+
+  /**
+   * Decodes a command table into an instruction record.
+   * @param address The address of the command table.
+   * @param instruction The instruction to decode into.
+   * @throws An error if the command is invalid.
+   */
+  void cC_Lesh::Decode_Instruction(int address, sInstruction& instruction) {
+    int row = 0;
+    instruction.decoded = false;
+    instruction.code = this->memory->Read(address, row++, 0); // Command is at origin.
+    instruction.base = instruction.code;
+    instruction.fused_count = 1;
+    if ((instruction.code < eCODE_STORE) || (instruction.code > eCODE_VECTOR)) {
+      throw cError("Invalid command " + Number_To_Text(instruction.code) + ".");
+    }
+    const char* layout = LAYOUTS[instruction.code];
+    int ref_count = 0;
+    int expr_count = 0;
+    instruction.cond_start = 0;
+    instruction.cond_count = 0;
+    for (int field_index = 0; layout[field_index] != '\0'; field_index++) {
+      switch (layout[field_index]) {
+        case 'r': {
+          this->Decode_Reference(address, row, instruction.refs[ref_count++]);
+          break;
+        }
+        case 'e': {
+          this->Decode_Expression(address, row, instruction.exprs[expr_count++]);
+          break;
+        }
+        case 'c': {
+          this->Decode_Conditional(address, row, instruction);
+          break;
+        }
+      }
+    }
+    if (instruction.code == eCODE_TEST) {
+      this->Fold_Test(address, instruction);
+    }
+    instruction.decoded = true;
+  }
+
+  /**
+   * Decodes a table reference. The reference takes up a row with the mode and address
+   * and objects have the property index on the next row. Value references point to the
+   * command itself, where the inline table is the row following the reference.
+   * @param address The address of the command table.
+   * @param row The row to decode. This is advanced past the reference.
+   * @param reference The reference to decode into.
+   * @throws An error if the mode is invalid.
+   */
+  void cC_Lesh::Decode_Reference(int address, int& row, sOperand& reference) {
+    reference.mode = this->memory->Read(address, row, 0);
+    reference.address = this->memory->Read(address, row++, 1);
+    reference.row = 0;
+    switch (reference.mode) {
       case eADDRESS_VALUE: {
-        break; // Return the command itself. The row has the value.
+        reference.address = address;
+        reference.row = row++;
+        break;
       }
-      case eADDRESS_IMMEDIATE: {
-        return this->Get_Table_At_Immediate_Address(address);
+      case eADDRESS_IMMEDIATE:
+      case eADDRESS_POINTER:
+      case eADDRESS_STACK: {
+        break;
       }
-      case eADDRESS_POINTER: {
-        return this->Get_Table_At_Pointer(address);
+      case eADDRESS_OBJECT_IMMEDIATE:
+      case eADDRESS_OBJECT_POINTER: {
+        reference.row = this->memory->Read(address, row++, 0);
+        break;
+      }
+      default: {
+        throw cError("Invalid store mode " + Number_To_Text(reference.mode) + ".");
       }
+    }
+  }
+
+  /**
+   * Decodes an operand from an expression row.
+   * @param address The address of the command table.
+   * @param row The row of the expression.
+   * @param col The column of the operand. This is advanced past the operand.
+   * @param operand The operand to decode into.
+   * @throws An error if the addressing mode is invalid.
+   */
+  void cC_Lesh::Decode_Operand(int address, int row, int& col, sOperand& operand) {
+    operand.mode = this->memory->Read(address, row, col++);
+    operand.address = this->memory->Read(address, row, col++); // The value for value operands.
+    operand.row = 0;
+    switch (operand.mode) {
+      case eADDRESS_VALUE:
+      case eADDRESS_IMMEDIATE:
+      case eADDRESS_POINTER:
       case eADDRESS_STACK: {
-        return this->Get_Table_At_Stack(address);
+        break;
       }
-      case eADDRESS_OBJECT_IMMEDIATE: {
-        int prop_index = command.Read_Column();
-        command.Move_To_Next_Row();
-        return this->Get_Object_At_Immediate_Address(address, prop_index);
+      case eADDRESS_OBJECT_IMMEDIATE:
+      case eADDRESS_OBJECT_POINTER: {
+        operand.row = this->memory->Read(address, row, col++);
+        break;
+      }
+      default: {
+        throw cError("Invalid address mode " + Number_To_Text(operand.mode) + ".");
+      }
+    }
+  }
+
+  /**
+   * Decodes an expression row into the term pool.
+   * @param address The address of the command table.
+   * @param row The row to decode. This is advanced past the expression.
+   * @param expression The expression to decode into.
+   * @throws An error if an operand or operator is invalid.
+   */
+  void cC_Lesh::Decode_Expression(int address, int& row, sExpression& expression) {
+    int col = 0;
+    sTerm term;
+    term.op = eOPERATOR_NONE;
+    this->Decode_Operand(address, row, col, term.operand);
+    expression.start = (int)this->terms.size();
+    expression.count = 1;
+    this->terms.push_back(term);
+    int op = this->memory->Read(address, row, col++);
+    while (op != eOPERATOR_NONE) {
+      if ((op < eOPERATOR_NONE) || (op > eOPERATOR_SINE)) {
+        throw cError("Invalid operator " + Number_To_Text(op) + ".");
+      }
+      term.op = op;
+      this->Decode_Operand(address, row, col, term.operand);
+      this->terms.push_back(term);
+      expression.count++;
+      op = this->memory->Read(address, row, col++);
+    }
+    row++;
+    this->Fold_Expression(expression);
+  }
+
+  /**
+   * Folds the constants of a freshly decoded expression. Operators apply left to right
+   * so leading constants fold into the first operand, while later constants only fold
+   * with their neighbors when both add or subtract, or both multiply. Random numbers
+   * are never folded. Folding uses the same operators as evaluation so dividing by zero
+   * behaves the same.
+   * @param expression The expression at the end of the term pool.
+   */
+  void cC_Lesh::Fold_Expression(sExpression& expression) {
+    std::vector<sTerm>::iterator terms = this->terms.begin() + expression.start;
+    int term_index = 1;
+    if (terms[0].operand.mode == eADDRESS_VALUE) {
+      while ((term_index < expression.count) && (terms[term_index].operand.mode == eADDRESS_VALUE) && (terms[term_index].op != eOPERATOR_RANDOM)) {
+        terms[0].operand.address = this->Apply_Operator(terms[term_index].op, terms[0].operand.address, terms[term_index].operand.address);
+        term_index++;
+      }
+      this->terms.erase(terms + 1, terms + term_index);
+      expression.count -= term_index - 1;
+      terms = this->terms.begin() + expression.start;
+    }
+    term_index = 1;
+    while (term_index < expression.count - 1) {
+      sTerm& term = terms[term_index];
+      sTerm& next = terms[term_index + 1];
+      bool sums = ((term.op == eOPERATOR_ADD) || (term.op == eOPERATOR_SUBTRACT)) && ((next.op == eOPERATOR_ADD) || (next.op == eOPERATOR_SUBTRACT));
+      bool products = (term.op == eOPERATOR_MULTIPLY) && (next.op == eOPERATOR_MULTIPLY);
+      if ((term.operand.mode == eADDRESS_VALUE) && (next.operand.mode == eADDRESS_VALUE) && (sums || products)) {
+        if (sums) {
+          int left = (term.op == eOPERATOR_ADD) ? term.operand.address : -term.operand.address;
+          int right = (next.op == eOPERATOR_ADD) ? next.operand.address : -next.operand.address;
+          term.op = eOPERATOR_ADD;
+          term.operand.address = left + right;
+        }
+        else {
+          term.operand.address *= next.operand.address;
+        }
+        this->terms.erase(terms + term_index + 1);
+        expression.count--;
+        terms = this->terms.begin() + expression.start;
+      }
+      else {
+        term_index++;
+      }
+    }
+    expression.constant = ((expression.count == 1) && (terms[0].operand.mode == eADDRESS_VALUE));
+    expression.value = terms[0].operand.address;
+  }
+
+  /**
+   * Decodes a conditional expression into the condition pool.
+   * @param address The address of the command table.
+   * @param row The row to decode. This is advanced past the conditional.
+   * @param instruction The instruction that owns the conditional.
+   * @throws An error if a test is invalid.
+   */
+  void cC_Lesh::Decode_Conditional(int address, int& row, sInstruction& instruction) {
+    sCondition condition;
+    instruction.cond_start = (int)this->conditions.size();
+    instruction.cond_count = 0;
+    do {
+      this->Decode_Expression(address, row, condition.left);
+      condition.test = this->memory->Read(address, row++, 0); // Test is on single row.
+      if ((condition.test < eTEST_EQUALS) || (condition.test > eTEST_GREATER_OR_EQUAL)) {
+        throw cError("Invalid test operator " + Number_To_Text(condition.test) + ".");
+      }
+      this->Decode_Expression(address, row, condition.right);
+      condition.logic = this->memory->Read(address, row++, 0); // One operator per row.
+      this->conditions.push_back(condition);
+      instruction.cond_count++;
+    } while (condition.logic != eLOGIC_NONE);
+  }
+
+  /**
+   * Turns a test whose outcome is known at load time into a jump. A test that takes no
+   * jump becomes a jump to the next command.
+   * @param address The address of the command.
+   * @param instruction The decoded test command.
+   */
+  void cC_Lesh::Fold_Test(int address, sInstruction& instruction) {
+    bool constant = instruction.exprs[0].constant && instruction.exprs[1].constant;
+    for (int cond_index = 0; cond_index < instruction.cond_count; cond_index++) {
+      sCondition& condition = this->conditions[instruction.cond_start + cond_index];
+      constant = constant && condition.left.constant && condition.right.constant;
+    }
+    if (constant) {
+      int result = this->Eval_Conditional(instruction);
+      int target = result ? instruction.exprs[0].value : instruction.exprs[1].value;
+      if (target == TAKE_NO_JUMP) {
+        target = address + 1;
+      }
+      sTerm term;
+      term.op = eOPERATOR_NONE;
+      term.operand.mode = eADDRESS_VALUE;
+      term.operand.address = target;
+      term.operand.row = 0;
+      instruction.code = eCODE_JUMP;
+      instruction.base = eCODE_JUMP;
+      instruction.exprs[0].start = (int)this->terms.size();
+      instruction.exprs[0].count = 1;
+      instruction.exprs[0].constant = true;
+      instruction.exprs[0].value = target;
+      instruction.cond_count = 0;
+      this->terms.push_back(term);
+    }
+  }
+
+  /**
+   * Fuses common runs of commands in part of the program. A store that adds a constant
+   * to a table followed by a test becomes an increment test, pushes followed by a call
+   * become a push call and two or more pops become a multi pop. Only the first command
+   * of a run changes, so jumps into the middle of a run still work. The tables of
+   * immediate operands that the run reads or writes at their origin are looked up here
+   * once instead of every time the run goes through.
+   * @param start The address of the first command.
+   * @param end The address after the last command.
+   */
+  void cC_Lesh::Fuse_Range(int start, int end) {
+    for (int address = start; address < end; address++) {
+      sInstruction& instruction = this->instructions[address - this->program_start];
+      if (instruction.decoded) {
+        int run = 1;
+        while ((address + run < this->program_end) && this->instructions[address + run - this->program_start].decoded &&
+          (this->instructions[address + run - this->program_start].base == instruction.base)) {
+          run++;
+        }
+        sInstruction* next = (address + run < this->program_end) ? &this->instructions[address + run - this->program_start] : NULL;
+        bool next_decoded = (next != NULL) && next->decoded;
+        instruction.code = instruction.base;
+        instruction.fused_count = 1;
+        instruction.fused_slot = NULL;
+        instruction.fused_value = 0;
+        instruction.fused_test = false;
+        switch (instruction.base) {
+          case eCODE_STORE: {
+            sExpression& expression = instruction.exprs[0];
+            sTerm* terms = &this->terms[expression.start];
+            if (this->Is_Origin(instruction.refs[0]) && (expression.count == 2) &&
+              (Base_Mode(terms[0].operand.mode) == eADDRESS_IMMEDIATE) && (terms[0].operand.address == instruction.refs[0].address) &&
+              ((terms[1].op == eOPERATOR_ADD) || (terms[1].op == eOPERATOR_SUBTRACT)) && (terms[1].operand.mode == eADDRESS_VALUE) &&
+              (address + 1 < this->program_end) && this->instructions[address + 1 - this->program_start].decoded &&
+              (this->instructions[address + 1 - this->program_start].base == eCODE_TEST)) {
+              instruction.code = eCODE_INCREMENT_TEST;
+              instruction.fused_count = 2;
+              instruction.fused_slot = &this->memory->Slot(instruction.refs[0].address);
+              // Subtracting is adding the negated amount, wrapping the same way.
+              instruction.fused_value = (terms[1].op == eOPERATOR_ADD) ? terms[1].operand.address : (int)(0u - (unsigned int)terms[1].operand.address);
+              instruction.fused_test = this->Is_Counter_Test(this->instructions[address + 1 - this->program_start], instruction.refs[0].address);
+            }
+            break;
+          }
+          case eCODE_PUSH: {
+            sExpression& expression = instruction.exprs[0];
+            if (!expression.constant && (expression.count == 1) && this->Is_Origin(this->terms[expression.start].operand)) {
+              instruction.fused_slot = &this->memory->Slot(this->terms[expression.start].operand.address);
+            }
+            if (next_decoded && (next->base == eCODE_CALL)) {
+              instruction.code = eCODE_PUSH_CALL;
+              instruction.fused_count = run + 1;
+            }
+            break;
+          }
+          case eCODE_POP: {
+            if (this->Is_Origin(instruction.refs[0])) {
+              instruction.fused_slot = &this->memory->Slot(instruction.refs[0].address);
+            }
+            if (run >= 2) {
+              instruction.code = eCODE_MULTI_POP;
+              instruction.fused_count = run;
+            }
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Determines if an operand or reference is the origin cell of a table in memory.
+   * @param operand The decoded operand or reference.
+   * @return True if the operand is an immediate table in memory.
+   */
+  bool cC_Lesh::Is_Origin(sOperand& operand) {
+    return ((Base_Mode(operand.mode) == eADDRESS_IMMEDIATE) && (operand.address >= 0) && (operand.address < this->memory->count));
+  }
+
+  /**
+   * Determines if a test only compares the origin of a table with constants and only
+   * jumps to constant addresses, so it can be run from the value of the table alone.
+   * @param test The decoded test.
+   * @param address The address of the table.
+   * @return True if the test can be run from the value of the table.
+   */
+  bool cC_Lesh::Is_Counter_Test(sInstruction& test, int address) {
+    if ((test.cond_count != 1) || !test.exprs[0].constant || !test.exprs[1].constant) {
+      return false;
+    }
+    sCondition& condition = this->conditions[test.cond_start];
+    sExpression* sides[2] = { &condition.left, &condition.right };
+    for (int side_index = 0; side_index < 2; side_index++) {
+      sExpression& side = *sides[side_index];
+      if (!side.constant) {
+        sOperand& operand = this->terms[side.start].operand;
+        if ((side.count != 1) || (Base_Mode(operand.mode) != eADDRESS_IMMEDIATE) || (operand.address != address)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Fetches the decoded instruction at an address. Commands outside of the program
+   * region are decoded every time they are fetched.
+   * @param address The address of the command.
+   * @return The decoded instruction.
+   * @throws An error if the command is invalid.
+   */
+  sInstruction& cC_Lesh::Fetch(int address) {
+    if ((address >= this->program_start) && (address < this->program_end)) {
+      int index = address - this->program_start;
+      if (!this->instructions[index].decoded) {
+        if ((int)this->terms.size() > this->pool_limit) {
+          this->Decode_Program(); // Reclaim the space left by stale decodes.
+        }
+        this->Decode_Instruction(address, this->instructions[index]);
+        this->Verify_Instruction(address, this->instructions[index]);
+        this->Fuse_Range(std::max(address - 1, this->program_start), address + 1); // The command before may fuse with it.
+      }
+      return this->instructions[index];
+    }
+    if ((int)this->terms.size() > this->pool_limit) {
+      this->Decode_Program();
+    }
+    this->Decode_Instruction(address, this->scratch);
+    return this->scratch;
+  }
+
+  /**
+   * Invalidates the decoded instruction at an address after its table was written.
+   * @param address The address of the table that was written.
+   */
+  void cC_Lesh::Invalidate(int address) {
+    if ((address >= this->program_start) && (address < this->program_end)) {
+      if (this->instructions[address - this->program_start].decoded) {
+        this->native = NULL; // A translated command was changed.
+      }
+      this->instructions[address - this->program_start].decoded = false;
+#ifdef C_LESH_JIT
+      if (this->jit_covered[address - this->program_start]) {
+        this->Flush_Jit(); // Compiled code has the old command baked in.
+      }
+#endif
+    }
+  }
+
+  /**
+   * Invalidates the decoded instructions of a range of tables after they were written.
+   * Only the part of the range inside the program region is touched.
+   * @param address The address of the first table that was written.
+   * @param count The number of tables.
+   */
+  void cC_Lesh::Invalidate_Range(int address, int count) {
+    int start = std::max(address, this->program_start);
+    int end = std::min(address + count, this->program_end);
+    for (int table_address = start; table_address < end; table_address++) {
+      this->Invalidate(table_address);
+    }
+  }
+
+  // **************************************************************************
+  // Verifier
+  // **************************************************************************
+
+  /**
+   * Verifies every decoded command of the program. Tables the verified commands rely
+   * on are remembered so the commands can be verified again if those tables shrink.
+   * Any table in the program may decode, data included, so nothing here throws. An
+   * operand that fails stays checked and the error is raised if the command runs. The
+   * failure is also kept as a diagnostic under the address of the command.
+   */
+  void cC_Lesh::Verify_Program() {
+    this->verified_rows.assign(this->memory->count, 0);
+    this->diagnostics.clear();
+    this->Verify_Range(this->program_start, this->program_end);
+  }
+
+  /**
+   * Verifies the decoded commands in part of the program.
+   * @param start The address of the first command.
+   * @param end The address after the last command.
+   */
+  void cC_Lesh::Verify_Range(int start, int end) {
+    for (int address = start; address < end; address++) {
+      sInstruction& instruction = this->instructions[address - this->program_start];
+      this->diagnostics.erase(address); // The command may no longer be one.
+      if (instruction.decoded) {
+        this->Verify_Instruction(address, instruction);
+      }
+    }
+  }
+
+  /**
+   * Verifies the table references and operands of a command. Immediate accesses that
+   * are proven to be in range switch to the unchecked memory path, while pointer and
+   * stack accesses are only known at run time and stay checked.
+   * @param address The address of the command.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::Verify_Instruction(int address, sInstruction& instruction) {
+    if (this->verified_rows.empty()) {
+      this->verified_rows.assign(this->memory->count, 0);
+    }
+    this->diagnostics.erase(address);
+    const char* layout = LAYOUTS[instruction.base];
+    int ref_count = 0;
+    int expr_count = 0;
+    for (int field_index = 0; layout[field_index] != '\0'; field_index++) {
+      switch (layout[field_index]) {
+        case 'r': {
+          this->Verify_Operand(address, instruction.refs[ref_count++], true);
+          break;
+        }
+        case 'e': {
+          this->Verify_Expression(address, instruction.exprs[expr_count++]);
+          break;
+        }
+        case 'c': {
+          for (int cond_index = 0; cond_index < instruction.cond_count; cond_index++) {
+            sCondition& condition = this->conditions[instruction.cond_start + cond_index];
+            this->Verify_Expression(address, condition.left);
+            this->Verify_Expression(address, condition.right);
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  /**
+   * Verifies the operands of an expression.
+   * @param address The address of the command.
+   * @param expression The decoded expression.
+   */
+  void cC_Lesh::Verify_Expression(int address, sExpression& expression) {
+    if (!expression.constant) {
+      for (int term_index = 0; term_index < expression.count; term_index++) {
+        this->Verify_Operand(address, this->terms[expression.start + term_index].operand, false);
+      }
+    }
+  }
+
+  /**
+   * Verifies an operand or table reference. Every table has an origin cell, so reading
+   * an immediate table only needs the address to be in memory. Writes and properties
+   * also need the row to be in the table as it is now. Operands outside of memory or
+   * with a negative property are left checked and the first of them in a command is
+   * kept as a diagnostic.
+   * @param address The address of the command.
+   * @param operand The decoded operand or reference.
+   * @param reference True if the operand is a table reference that may be written.
+   */
+  void cC_Lesh::Verify_Operand(int address, sOperand& operand, bool reference) {
+    operand.mode = Base_Mode(operand.mode);
+    if ((operand.mode == eADDRESS_IMMEDIATE) || (operand.mode == eADDRESS_OBJECT_IMMEDIATE)) {
+      if ((operand.address < 0) || (operand.address >= this->memory->count) || (operand.row < 0)) {
+        if (this->diagnostics.find(address) == this->diagnostics.end()) {
+          this->diagnostics[address] = (operand.row < 0) ?
+            "Command at " + Number_To_Text(address) + " refers to property " + Number_To_Text(operand.row) + " of table " + Number_To_Text(operand.address) + "." :
+            "Command at " + Number_To_Text(address) + " refers to table " + Number_To_Text(operand.address) + " outside of memory.";
+        }
+        return; // Only an error if the command runs.
+      }
+      sTable_Slot& table = this->memory->Slot(operand.address);
+      bool object = (operand.mode == eADDRESS_OBJECT_IMMEDIATE);
+      if (!object && !reference) {
+        operand.mode = eADDRESS_VERIFIED_IMMEDIATE;
+      }
+      else if ((table.width > 0) && (operand.row < table.height)) {
+        operand.mode = object ? eADDRESS_VERIFIED_OBJECT : eADDRESS_VERIFIED_IMMEDIATE;
+        this->verified_rows[operand.address] = std::max(this->verified_rows[operand.address], operand.row + 1);
+      }
+      // Otherwise the table may still grow before the command runs.
+    }
+  }
+
+  /**
+   * Prints the diagnostics of the verifier as warnings. Data in the program can decode
+   * as a command, so they do not stop the program from loading.
+   */
+  void cC_Lesh::Report_Diagnostics() {
+    for (std::map<int, std::string>::iterator diagnostic = this->diagnostics.begin(); diagnostic != this->diagnostics.end(); ++diagnostic) {
+      std::cout << "Warning: " << diagnostic->second << std::endl;
+    }
+  }
+
+  /**
+   * Verifies the program again if tables that verified commands rely on no longer
+   * have the rows they had.
+   * @param address The address of the first table that changed.
+   * @param count The number of tables that changed.
+   */
+  void cC_Lesh::Check_Shapes(int address, int count) {
+    int end = std::min(address + count, (int)this->verified_rows.size());
+    for (int table_address = std::max(address, 0); table_address < end; table_address++) {
+      sTable_Slot& table = this->memory->Slot(table_address);
+      int rows = this->verified_rows[table_address];
+      if ((rows > 0) && ((table.width < 1) || (table.height < rows))) {
+        this->Verify_Program();
+        break;
+      }
+    }
+  }
+
+  /**
+   * Gets the mode a verified operand was decoded with.
+   * @param mode The address mode.
+   * @return The mode before verification.
+   */
+  int cC_Lesh::Base_Mode(int mode) {
+    if (mode == eADDRESS_VERIFIED_IMMEDIATE) {
+      mode = eADDRESS_IMMEDIATE;
+    }
+    else if (mode == eADDRESS_VERIFIED_OBJECT) {
+      mode = eADDRESS_OBJECT_IMMEDIATE;
+    }
+    return mode;
+  }
+
+  // **************************************************************************
+  // Faults
+  // **************************************************************************
+
+  /**
+   * Records the command that raised a fault and ends the run with an error status.
+   * @param address The address of the command.
+   */
+  void cC_Lesh::Record_Fault(int address) {
+    sFault& fault = this->memory->fault;
+    if (fault.command < 0) {
+      bool in_program = (address >= this->program_start) && (address < this->program_end);
+      sInstruction& instruction = in_program ? this->instructions[address - this->program_start] : this->scratch;
+      fault.command = address;
+      fault.opcode = instruction.code;
+      fault.operand = instruction.decoded ? this->Fault_Operand(instruction, fault.address) : -1;
+    }
+    this->status = eSTATUS_ERROR;
+  }
+
+  /**
+   * Finds the operand of a command that accesses a table. Operands are numbered in
+   * the order they are decoded, with every term of an expression counted.
+   * @param instruction The decoded command.
+   * @param address The address of the table.
+   * @return The index of the operand or -1 if no operand accesses the table.
+   */
+  int cC_Lesh::Fault_Operand(sInstruction& instruction, int address) {
+    std::vector<sOperand*> operands;
+    const char* layout = LAYOUTS[instruction.base];
+    int ref_count = 0;
+    int expr_count = 0;
+    for (int field_index = 0; layout[field_index] != '\0'; field_index++) {
+      std::vector<sExpression*> expressions;
+      switch (layout[field_index]) {
+        case 'r': {
+          operands.push_back(&instruction.refs[ref_count++]);
+          break;
+        }
+        case 'e': {
+          expressions.push_back(&instruction.exprs[expr_count++]);
+          break;
+        }
+        case 'c': {
+          for (int cond_index = 0; cond_index < instruction.cond_count; cond_index++) {
+            expressions.push_back(&this->conditions[instruction.cond_start + cond_index].left);
+            expressions.push_back(&this->conditions[instruction.cond_start + cond_index].right);
+          }
+          break;
+        }
+      }
+      for (size_t expr_index = 0; expr_index < expressions.size(); expr_index++) {
+        for (int term_index = 0; term_index < expressions[expr_index]->count; term_index++) {
+          operands.push_back(&this->terms[expressions[expr_index]->start + term_index].operand);
+        }
+      }
+    }
+    for (int operand_index = 0; operand_index < (int)operands.size(); operand_index++) {
+      sOperand& operand = *operands[operand_index];
+      int target = operand.address;
+      switch (Base_Mode(operand.mode)) {
+        case eADDRESS_VALUE: {
+          target = -1;
+          break;
+        }
+        case eADDRESS_POINTER:
+        case eADDRESS_OBJECT_POINTER: {
+          if ((operand.address >= 0) && (operand.address < this->memory->count) && (operand.address != address)) {
+            target = this->memory->Slot(operand.address).cells[0];
+          }
+          break;
+        }
+        case eADDRESS_STACK: {
+          target = this->stack_pointer - operand.address;
+          break;
+        }
+      }
+      if (target == address) {
+        return operand_index;
+      }
+    }
+    return -1;
+  }
+
+  /**
+   * Turns the fault record into an error.
+   * @return The error describing the fault.
+   */
+  cError cC_Lesh::Fault_Error() {
+    sFault& fault = this->memory->fault;
+    if (fault.command < 0) {
+      this->Record_Fault(this->command_pointer - 1);
+    }
+    std::string message = "";
+    switch (fault.code) {
+      case eFAULT_ADDRESS: {
+        message = "Invalid address accessed at " + Number_To_Text(fault.address);
+        break;
+      }
+      case eFAULT_CELL: {
+        message = "Invalid cell " + Number_To_Text(fault.col) + "," + Number_To_Text(fault.row) + " accessed at " + Number_To_Text(fault.address);
+        break;
+      }
+      case eFAULT_STACK_OVERFLOW: {
+        message = "Stack overflow at " + Number_To_Text(fault.address);
+        break;
+      }
+      case eFAULT_STACK_UNDERFLOW: {
+        message = "Stack underflow at " + Number_To_Text(fault.address);
+        break;
+      }
+      case eFAULT_SIZE: {
+        message = "Invalid table size " + Number_To_Text(fault.col) + "x" + Number_To_Text(fault.row) + " at " + Number_To_Text(fault.address);
+        break;
+      }
+      case eFAULT_RANGE: {
+        message = "Invalid range of " + Number_To_Text(fault.col) + " tables at " + Number_To_Text(fault.address);
+        break;
+      }
+      case eFAULT_MODE: {
+        message = "Invalid mode " + Number_To_Text(fault.col) + " for " + Number_To_Text(fault.address);
+        break;
+      }
+      case eFAULT_OPERATOR: {
+        message = "Invalid operator " + Number_To_Text(fault.col);
+        break;
+      }
+    }
+    message += " by command " + Number_To_Text(fault.command) + " with code " + Number_To_Text(fault.opcode);
+    if (fault.operand >= 0) {
+      message += " at operand " + Number_To_Text(fault.operand);
+    }
+    return cError(message + ".");
+  }
+
+#ifdef C_LESH_JIT
+  // **************************************************************************
+  // JIT Compiler
+  // **************************************************************************
+
+  // Registers in x86-64 encoding order.
+  enum eRegister {
+    eREG_EAX = 0,
+    eREG_ECX = 1
+  };
+
+  /**
+   * Runs compiled blocks for as long as the command pointer lands on one.
+   * @param count The maximum number of commands to run.
+   * @param executed The number of commands run so far. This is updated.
+   * @return True if all of the commands were run, false otherwise.
+   */
+  bool cC_Lesh::Enter_Jit(int count, int& executed) {
+    int ran = this->Run_Block(count - executed);
+    while (ran > 0) {
+      executed += ran;
+      if (executed >= count) {
+        return true;
+      }
+      ran = this->Run_Block(count - executed);
+    }
+    return false;
+  }
+
+  /**
+   * Runs the compiled block at the command pointer. Commands are counted as they are
+   * run and a block is compiled once its first command gets hot. A block is only run
+   * if a whole pass through it fits in the limit, and it only loops while another pass
+   * still fits, so the limit is never overrun.
+   * @param limit The number of commands a block may run before it has to return.
+   * @return The number of commands the block ran. This is zero if there was no block.
+   */
+  int cC_Lesh::Run_Block(int limit) {
+    int index = this->command_pointer - this->program_start;
+    if ((index < 0) || (index >= (int)this->jit_entries.size())) {
+      return 0;
+    }
+    tJit_Block block = this->jit_entries[index];
+    if (block == NULL) {
+      if ((this->jit_heat[index] > C_LESH_JIT_THRESHOLD) || (++this->jit_heat[index] < C_LESH_JIT_THRESHOLD)) {
+        return 0;
+      }
+      this->jit_heat[index]++; // Only try once.
+      this->jit_code->Make_Writable();
+      block = this->Compile_Block(this->command_pointer);
+      this->jit_code->Make_Executable();
+      if (block == NULL) {
+        return 0;
+      }
+    }
+    int length = this->jit_lengths[index];
+    if (length > limit) {
+      return 0; // The interpreter runs what is left of the budget.
+    }
+    this->jit_executed = 0;
+    this->jit_limit = limit - length + 1; // Loops while executed + length <= limit.
+    this->command_pointer = block();
+    return this->jit_executed;
+  }
+
+  /**
+   * Compiles the commands from an address up to the first branch into x86-64 code.
+   * Compiled code returns the next command address and adds the commands it ran to
+   * jit_executed. It only uses registers that are free to use in both the System V and
+   * the Windows calling conventions, and leaves the stack alone.
+   * @param address The address of the first command.
+   * @return The compiled block or NULL if the first command can not be compiled.
+   */
+  tJit_Block cC_Lesh::Compile_Block(int address) {
+    cCode_Buffer& code = *this->jit_code;
+    int entry = code.used;
+    int cmd_address = address;
+    int count = 0;
+    bool ended = false;
+    while (!ended && (count < C_LESH_JIT_BLOCK_SIZE) && (cmd_address < this->program_end)) {
+      sInstruction& instruction = this->instructions[cmd_address - this->program_start];
+      if (!instruction.decoded || !this->Can_Compile(instruction)) {
+        break;
+      }
+      switch (instruction.base) {
+        case eCODE_STORE: {
+          sTable_Slot* slot = &this->memory->Slot(instruction.refs[0].address);
+          code.Emit(0x49); code.Emit(0xB8); code.Emit_64(slot); // mov r8, &slot
+          code.Emit(0x41); code.Emit(0x83); code.Emit(0x78); code.Emit((int)offsetof(sTable_Slot, width)); code.Emit(0x00); // cmp dword [r8 + width], 0
+          int no_width = code.Emit_Jump(0x84); // je bail
+          code.Emit(0x41); code.Emit(0x83); code.Emit(0x78); code.Emit((int)offsetof(sTable_Slot, height)); code.Emit(0x00); // cmp dword [r8 + height], 0
+          int no_height = code.Emit_Jump(0x84); // je bail
+          this->Emit_Expression(instruction.exprs[0]);
+          code.Emit(0x49); code.Emit(0xB8); code.Emit_64(slot); // mov r8, &slot
+          code.Emit(0x41); code.Emit(0xFF); code.Emit(0x40); code.Emit((int)offsetof(sTable_Slot, stamp)); // inc dword [r8 + stamp]
+          code.Emit(0x4D); code.Emit(0x8B); code.Emit(0x40); code.Emit((int)offsetof(sTable_Slot, cells)); // mov r8, [r8 + cells]
+          code.Emit(0x41); code.Emit(0x89); code.Emit(0x00); // mov [r8], eax
+          int stored = code.Emit_Jump(0xE9); // jmp past bail
+          code.Patch(no_width);
+          code.Patch(no_height);
+          this->Emit_Exit(cmd_address, count, address, entry); // Empty tables have no cell to store to.
+          code.Patch(stored);
+          break;
+        }
+        case eCODE_TEST: {
+          static const int setcc[] = { 0x94, 0x95, 0x9C, 0x9F, 0x9E, 0x9D }; // sete, setne, setl, setg, setle, setge
+          for (int cond_index = 0; cond_index < instruction.cond_count; cond_index++) {
+            sCondition& condition = this->conditions[instruction.cond_start + cond_index];
+            this->Emit_Expression(condition.left);
+            code.Emit(0x41); code.Emit(0x89); code.Emit(0xC1); // mov r9d, eax
+            this->Emit_Expression(condition.right);
+            code.Emit(0x44); code.Emit(0x29); code.Emit(0xC8); // sub eax, r9d
+            code.Emit(0x85); code.Emit(0xC0); // test eax, eax
+            code.Emit(0x0F); code.Emit(setcc[condition.test]); code.Emit(0xC2); // setcc dl
+            code.Emit(0x0F); code.Emit(0xB6); code.Emit(0xD2); // movzx edx, dl
+            int logic = (cond_index == 0) ? eLOGIC_NONE : this->conditions[instruction.cond_start + cond_index - 1].logic;
+            if (cond_index == 0) {
+              code.Emit(0x41); code.Emit(0x89); code.Emit(0xD3); // mov r11d, edx
+            }
+            else if (logic == eLOGIC_AND) {
+              code.Emit(0x44); code.Emit(0x0F); code.Emit(0xAF); code.Emit(0xDA); // imul r11d, edx
+            }
+            else if (logic == eLOGIC_OR) {
+              code.Emit(0x41); code.Emit(0x01); code.Emit(0xD3); // add r11d, edx
+            }
+          }
+          int passed = (instruction.exprs[0].value != TAKE_NO_JUMP) ? instruction.exprs[0].value : cmd_address + 1;
+          int failed = (instruction.exprs[1].value != TAKE_NO_JUMP) ? instruction.exprs[1].value : cmd_address + 1;
+          code.Emit(0x45); code.Emit(0x85); code.Emit(0xDB); // test r11d, r11d
+          int jump = code.Emit_Jump(0x84); // jz failed
+          this->Emit_Exit(passed, count + 1, address, entry);
+          code.Patch(jump);
+          this->Emit_Exit(failed, count + 1, address, entry);
+          ended = true;
+          break;
+        }
+        case eCODE_JUMP: {
+          this->Emit_Exit(instruction.exprs[0].value, count + 1, address, entry);
+          ended = true;
+          break;
+        }
+        case eCODE_CALL: {
+          code.Emit(0x49); code.Emit(0xB8); code.Emit_64(&this->stack_pointer); // mov r8, &stack_pointer
+          code.Emit(0x41); code.Emit(0x8B); code.Emit(0x08); // mov ecx, [r8]
+          code.Emit(0x81); code.Emit(0xF9); code.Emit_32(this->stack_cells ? this->stack_start + this->stack_size : this->memory->count); // cmp ecx, end of stack
+          int outside = code.Emit_Jump(0x83); // jae bail
+          int below = -1;
+          if (this->stack_cells) {
+            code.Emit(0x81); code.Emit(0xF9); code.Emit_32(this->stack_start); // cmp ecx, stack_start
+            below = code.Emit_Jump(0x8C); // jl bail
+          }
+          code.Emit(0x89); code.Emit(0xCA); // mov edx, ecx
+          code.Emit(0x81); code.Emit(0xEA); code.Emit_32(this->program_start); // sub edx, program_start
+          code.Emit(0x81); code.Emit(0xFA); code.Emit_32(this->program_end - this->program_start); // cmp edx, program size
+          int inside = code.Emit_Jump(0x82); // jb bail
+          int untouched = this->Emit_Slot();
+          code.Emit(0x4C); code.Emit(0x8B); code.Emit(0x52); code.Emit((int)offsetof(sTable_Slot, cells)); // mov r10, [rdx + cells]
+          code.Emit(0x41); code.Emit(0xC7); code.Emit(0x02); code.Emit_32(cmd_address + 1); // mov dword [r10], return address
+          code.Emit(0xFF); code.Emit(0x42); code.Emit((int)offsetof(sTable_Slot, stamp)); // inc dword [rdx + stamp]
+          code.Emit(0x41); code.Emit(0xFF); code.Emit(0x00); // inc dword [r8]
+          this->Emit_Exit(instruction.exprs[0].value, count + 1, address, entry);
+          code.Patch(untouched);
+          code.Patch(outside);
+          code.Patch(inside);
+          if (below >= 0) {
+            code.Patch(below);
+          }
+          this->Emit_Exit(cmd_address, count, address, entry); // Let the interpreter report the error.
+          ended = true;
+          break;
+        }
+        case eCODE_RETURN: {
+          code.Emit(0x49); code.Emit(0xB8); code.Emit_64(&this->stack_pointer); // mov r8, &stack_pointer
+          code.Emit(0x41); code.Emit(0x8B); code.Emit(0x08); // mov ecx, [r8]
+          code.Emit(0x83); code.Emit(0xE9); code.Emit(0x01); // sub ecx, 1
+          code.Emit(0x81); code.Emit(0xF9); code.Emit_32(this->memory->count); // cmp ecx, count
+          int outside = code.Emit_Jump(0x83); // jae bail
+          int below = -1;
+          if (this->stack_cells) {
+            code.Emit(0x81); code.Emit(0xF9); code.Emit_32(this->stack_start); // cmp ecx, stack_start
+            below = code.Emit_Jump(0x8C); // jl bail
+          }
+          int untouched = this->Emit_Slot();
+          code.Emit(0x4C); code.Emit(0x8B); code.Emit(0x52); code.Emit((int)offsetof(sTable_Slot, cells)); // mov r10, [rdx + cells]
+          code.Emit(0x41); code.Emit(0x8B); code.Emit(0x02); // mov eax, [r10]
+          code.Emit(0x41); code.Emit(0x89); code.Emit(0x08); // mov [r8], ecx
+          code.Emit(0x48); code.Emit(0xBA); code.Emit_64(&this->jit_executed); // mov rdx, &jit_executed
+          code.Emit(0x81); code.Emit(0x02); code.Emit_32(count + 1); // add dword [rdx], executed
+          code.Emit(0xC3); // ret
+          code.Patch(untouched);
+          code.Patch(outside);
+          if (below >= 0) {
+            code.Patch(below);
+          }
+          this->Emit_Exit(cmd_address, count, address, entry);
+          ended = true;
+          break;
+        }
+      }
+      count++;
+      cmd_address++;
+    }
+    if (count == 0) {
+      code.used = entry;
+      return NULL;
+    }
+    if (!ended) {
+      this->Emit_Exit(cmd_address, count, address, entry);
+    }
+    if (code.used > code.size) { // Out of space. Start over.
+      this->Flush_Jit();
+      return NULL;
+    }
+    for (int covered = address; covered < cmd_address; covered++) {
+      this->jit_covered[covered - this->program_start] = 1;
+    }
+    tJit_Block block = reinterpret_cast<tJit_Block>(code.code + entry);
+    this->jit_entries[address - this->program_start] = block;
+    this->jit_lengths[address - this->program_start] = count; // No pass runs more commands.
+    this->jit_blocks++;
+    return block;
+  }
+
+  /**
+   * Determines if a command can be compiled. Only stores to fixed tables outside the
+   * program, branches to fixed addresses and returns are compiled.
+   * @param instruction The decoded command.
+   * @return True if the command can be compiled, false otherwise.
+   */
+  bool cC_Lesh::Can_Compile(sInstruction& instruction) {
+    bool compile = false;
+    switch (instruction.base) {
+      case eCODE_STORE: {
+        sOperand& reference = instruction.refs[0];
+        compile = (Base_Mode(reference.mode) == eADDRESS_IMMEDIATE) && (reference.address >= 0) && (reference.address < this->memory->count) &&
+          ((reference.address < this->program_start) || (reference.address >= this->program_end)) &&
+          this->Can_Compile_Expression(instruction.exprs[0]);
+        break;
+      }
+      case eCODE_TEST: {
+        compile = instruction.exprs[0].constant && instruction.exprs[1].constant;
+        for (int cond_index = 0; cond_index < instruction.cond_count; cond_index++) {
+          sCondition& condition = this->conditions[instruction.cond_start + cond_index];
+          compile = compile && this->Can_Compile_Expression(condition.left) && this->Can_Compile_Expression(condition.right);
+        }
+        break;
+      }
+      case eCODE_JUMP:
+      case eCODE_CALL: {
+        compile = instruction.exprs[0].constant;
+        break;
+      }
+      case eCODE_RETURN: {
+        compile = true;
+        break;
+      }
+    }
+    return compile;
+  }
+
+  /**
+   * Determines if an expression can be compiled. Operands have to be values or fixed
+   * tables, and only arithmetic operators are compiled.
+   * @param expression The decoded expression.
+   * @return True if the expression can be compiled, false otherwise.
+   */
+  bool cC_Lesh::Can_Compile_Expression(sExpression& expression) {
+    if (expression.constant) {
+      return true;
+    }
+    for (int term_index = 0; term_index < expression.count; term_index++) {
+      sTerm& term = this->terms[expression.start + term_index];
+      if ((term_index > 0) && ((term.op < eOPERATOR_ADD) || (term.op > eOPERATOR_REMAINDER))) {
+        return false;
+      }
+      if (Base_Mode(term.operand.mode) == eADDRESS_IMMEDIATE) {
+        if ((term.operand.address < 0) || (term.operand.address >= this->memory->count)) {
+          return false;
+        }
+      }
+      else if (term.operand.mode != eADDRESS_VALUE) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Emits code that loads an operand into a register.
+   * @param reg The register, either eax or ecx.
+   * @param operand The decoded operand.
+   */
+  void cC_Lesh::Emit_Operand(int reg, sOperand& operand) {
+    cCode_Buffer& code = *this->jit_code;
+    if (operand.mode == eADDRESS_VALUE) {
+      code.Emit(0xB8 + reg); code.Emit_32(operand.address); // mov reg, value
+    }
+    else {
+      code.Emit(0x49); code.Emit(0xB8); code.Emit_64(&this->memory->Slot(operand.address).cells); // mov r8, &cells
+      code.Emit(0x4D); code.Emit(0x8B); code.Emit(0x00); // mov r8, [r8]
+      code.Emit(0x41); code.Emit(0x8B); code.Emit(reg << 3); // mov reg, [r8]
+    }
+  }
+
+  /**
+   * Emits code that evaluates an expression into eax. Division and remainder by zero
+   * work the same as in Apply_Operator().
+   * @param expression The decoded expression.
+   */
+  void cC_Lesh::Emit_Expression(sExpression& expression) {
+    cCode_Buffer& code = *this->jit_code;
+    if (expression.constant) {
+      code.Emit(0xB8); code.Emit_32(expression.value); // mov eax, value
+      return;
+    }
+    sTerm* terms = &this->terms[expression.start];
+    this->Emit_Operand(eREG_EAX, terms[0].operand);
+    for (int term_index = 1; term_index < expression.count; term_index++) {
+      this->Emit_Operand(eREG_ECX, terms[term_index].operand);
+      switch (terms[term_index].op) {
+        case eOPERATOR_ADD: {
+          code.Emit(0x01); code.Emit(0xC8); // add eax, ecx
+          break;
+        }
+        case eOPERATOR_SUBTRACT: {
+          code.Emit(0x29); code.Emit(0xC8); // sub eax, ecx
+          break;
+        }
+        case eOPERATOR_MULTIPLY: {
+          code.Emit(0x0F); code.Emit(0xAF); code.Emit(0xC1); // imul eax, ecx
+          break;
+        }
+        case eOPERATOR_DIVIDE: {
+          code.Emit(0x85); code.Emit(0xC9); // test ecx, ecx
+          code.Emit(0x74); code.Emit(0x03); // jz past the division
+          code.Emit(0x99); // cdq
+          code.Emit(0xF7); code.Emit(0xF9); // idiv ecx
+          break;
+        }
+        case eOPERATOR_REMAINDER: {
+          code.Emit(0x85); code.Emit(0xC9); // test ecx, ecx
+          code.Emit(0x75); code.Emit(0x04); // jnz to the division
+          code.Emit(0x31); code.Emit(0xC0); // xor eax, eax
+          code.Emit(0xEB); code.Emit(0x05); // jmp past the division
+          code.Emit(0x99); // cdq
+          code.Emit(0xF7); code.Emit(0xF9); // idiv ecx
+          code.Emit(0x89); code.Emit(0xD0); // mov eax, edx
+          break;
+        }
+      }
+    }
+  }
+
+  /**
+   * Emits code that points rdx at the memory slot with the index in rcx. Slots that
+   * were never touched are left to the interpreter to set up.
+   * @return The jump to patch with the bail out for an untouched slot.
+   */
+  int cC_Lesh::Emit_Slot() {
+    cCode_Buffer& code = *this->jit_code;
+    code.Emit(0x89); code.Emit(0xCA); // mov edx, ecx
+    code.Emit(0xC1); code.Emit(0xEA); code.Emit(C_LESH_SLOT_SHIFT); // shr edx, slot shift
+    code.Emit(0x48); code.Emit(0xB8); code.Emit_64(&this->memory->touched[0]); // mov rax, touched
+    code.Emit(0x80); code.Emit(0x3C); code.Emit(0x10); code.Emit(0x00); // cmp byte [rax + rdx], 0
+    int untouched = code.Emit_Jump(0x84); // je bail
+    code.Emit(0x48); code.Emit(0x69); code.Emit(0xD1); code.Emit_32((int)sizeof(sTable_Slot)); // imul rdx, rcx, slot size
+    code.Emit(0x48); code.Emit(0xB8); code.Emit_64(this->memory->slots); // mov rax, slots
+    code.Emit(0x48); code.Emit(0x01); code.Emit(0xC2); // add rdx, rax
+    return untouched;
+  }
+
+  /**
+   * Emits code that leaves the block for a command address. Branches back to the start
+   * of the block loop inside the block while jit_limit, which already leaves room for a
+   * whole pass, is not reached.
+   * @param target The address of the next command.
+   * @param executed The number of commands run when the exit is taken.
+   * @param address The address of the first command of the block.
+   * @param entry The position of the block in the code buffer.
+   */
+  void cC_Lesh::Emit_Exit(int target, int executed, int address, int entry) {
+    cCode_Buffer& code = *this->jit_code;
+    code.Emit(0x48); code.Emit(0xB8); code.Emit_64(&this->jit_executed); // mov rax, &jit_executed
+    if ((target == address) && (executed > 0)) {
+      code.Emit(0x8B); code.Emit(0x08); // mov ecx, [rax]
+      code.Emit(0x81); code.Emit(0xC1); code.Emit_32(executed); // add ecx, executed
+      code.Emit(0x89); code.Emit(0x08); // mov [rax], ecx
+      code.Emit(0x48); code.Emit(0xBA); code.Emit_64(&this->jit_limit); // mov rdx, &jit_limit
+      code.Emit(0x3B); code.Emit(0x0A); // cmp ecx, [rdx]
+      code.Emit(0x0F); code.Emit(0x8C); code.Emit_32(entry - (code.used + 4)); // jl entry
+    }
+    else {
+      code.Emit(0x81); code.Emit(0x00); code.Emit_32(executed); // add dword [rax], executed
+    }
+    code.Emit(0xB8); code.Emit_32(target); // mov eax, target
+    code.Emit(0xC3); // ret
+  }
+
+  /**
+   * Throws away all compiled blocks.
+   */
+  void cC_Lesh::Flush_Jit() {
+    this->jit_code->used = 0;
+    std::fill(this->jit_entries.begin(), this->jit_entries.end(), (tJit_Block)NULL);
+    std::fill(this->jit_heat.begin(), this->jit_heat.end(), 0);
+    std::fill(this->jit_covered.begin(), this->jit_covered.end(), 0);
+  }
+#endif
+
+  // **************************************************************************
+  // Native Translator
+  // **************************************************************************
+
+  // Methods the translated code calls for commands it leaves to the interpreter.
+  static const char* HANDLER_NAMES[] = {
+    "Store", "Dump", "Test", "Jump", "Call", "Return", "Push", "Pop", "Load", "Save",
+    "Input", "Refresh", "Sound", "Timeout", "Output", "String", "Palette", "Draw", "Clear",
+    "Resize", "Column", "Stop", "Copy", "Block", "Fill", "Vector"
+  };
+
+  // C++ comparison of each test operator against zero.
+  static const char* TEST_OPERATORS[] = { "==", "!=", "<", ">", "<=", ">=" };
+
+  /**
+   * Translates the loaded program to a C++ translation unit. Every command becomes a
+   * labeled block that falls through to the next command, and jumps to fixed addresses
+   * go straight to their label. The tables of the program are written out too so a
+   * native build does not need the program files. Commands that work with files,
+   * input, sound or the screen still call the command methods.
+   * @param name The name of the program.
+   * @param output The name of the C++ file to write.
+   * @throws An error if the file could not be written.
+   */
+  void cC_Lesh::Translate(std::string name, std::string output) {
+    std::ofstream out(output.c_str());
+    if (!out) {
+      throw cError("Could not write " + output + ".");
+    }
+    int count = this->program_end - this->program_start;
+    std::vector<sOperand> operands;
+    std::ostringstream body;
+    for (int instr_index = 0; instr_index < count; instr_index++) {
+      sInstruction& instruction = this->instructions[instr_index];
+      if (!instruction.decoded) {
+        continue; // Tables that are not commands are only data.
+      }
+      int address = this->program_start + instr_index;
+      int next = address + 1;
+      bool labeled = (next < this->program_end) && this->instructions[instr_index + 1].decoded;
+      std::map<int, std::string>::iterator symbol = this->symbols.find(address);
+      if (symbol != this->symbols.end()) {
+        body << "    // " << symbol->second << "\n";
+      }
+      body << "    C_LESH_NATIVE_BEGIN(" << address << ", " << next << ");\n";
+      body << "    {\n";
+      switch (instruction.base) {
+        case eCODE_STORE: {
+          this->Translate_Expression(body, instruction.exprs[0], "value", operands);
+          operands.push_back(instruction.refs[0]);
+          body << "      clsh.Write_Table_At_Address(OPERANDS[" << (operands.size() - 1) << "], value);\n";
+          break;
+        }
+        case eCODE_TEST: {
+          sCondition* conditions = &this->conditions[instruction.cond_start];
+          for (int cond_index = 0; cond_index < instruction.cond_count; cond_index++) {
+            std::string id = Number_To_Text(cond_index);
+            this->Translate_Expression(body, conditions[cond_index].left, "left" + id, operands);
+            this->Translate_Expression(body, conditions[cond_index].right, "right" + id, operands);
+            std::string test = "((right" + id + " - left" + id + ") " + TEST_OPERATORS[conditions[cond_index].test] + " 0)";
+            if (cond_index == 0) {
+              body << "      int result = " << test << ";\n";
+            }
+            else {
+              body << "      result " << ((conditions[cond_index - 1].logic == eLOGIC_OR) ? "+=" : "*=") << " " << test << ";\n";
+            }
+          }
+          sExpression& passed = instruction.exprs[0];
+          sExpression& failed = instruction.exprs[1];
+          if (passed.constant && failed.constant) {
+            if (passed.value != TAKE_NO_JUMP) {
+              body << "      if (result) {\n";
+              body << "        clsh.command_pointer = " << passed.value << ";\n";
+              body << "        " << this->Translate_Jump(passed.value) << "\n";
+              body << "      }\n";
+            }
+            if (failed.value != TAKE_NO_JUMP) {
+              body << "      if (!result) {\n";
+              body << "        clsh.command_pointer = " << failed.value << ";\n";
+              body << "        " << this->Translate_Jump(failed.value) << "\n";
+              body << "      }\n";
+            }
+          }
+          else {
+            this->Translate_Expression(body, passed, "passed", operands);
+            this->Translate_Expression(body, failed, "failed", operands);
+            body << "      if ((passed != TAKE_NO_JUMP) && result) {\n";
+            body << "        clsh.command_pointer = passed;\n";
+            body << "      }\n";
+            body << "      if ((failed != TAKE_NO_JUMP) && !result) {\n";
+            body << "        clsh.command_pointer = failed;\n";
+            body << "      }\n";
+          }
+          break;
+        }
+        case eCODE_JUMP: {
+          if (instruction.exprs[0].constant) {
+            body << "      clsh.command_pointer = " << instruction.exprs[0].value << ";\n";
+            body << "      " << this->Translate_Jump(instruction.exprs[0].value) << "\n";
+          }
+          else {
+            this->Translate_Expression(body, instruction.exprs[0], "target", operands);
+            body << "      clsh.command_pointer = target;\n";
+          }
+          break;
+        }
+        case eCODE_CALL: {
+          body << "      clsh.Stack_Push(clsh.command_pointer);\n";
+          this->Translate_Expression(body, instruction.exprs[0], "target", operands);
+          body << "      clsh.command_pointer = target;\n";
+          break;
+        }
+        case eCODE_PUSH: {
+          this->Translate_Expression(body, instruction.exprs[0], "value", operands);
+          body << "      clsh.Stack_Push(value);\n";
+          break;
+        }
+        case eCODE_POP: {
+          operands.push_back(instruction.refs[0]);
+          body << "      clsh.Write_Table_At_Address(OPERANDS[" << (operands.size() - 1) << "], clsh.Stack_Pop());\n";
+          break;
+        }
+        case eCODE_STOP: {
+          body << "      clsh.Stop(clsh.instructions[" << instr_index << "]);\n";
+          body << "      return executed;\n";
+          break;
+        }
+        default: {
+          body << "      clsh." << HANDLER_NAMES[instruction.base] << "(clsh.instructions[" << instr_index << "]);\n";
+          break;
+        }
+      }
+      body << "    }\n";
+      if (labeled) {
+        body << "    C_LESH_NATIVE_END(" << next << ");\n";
+      }
+      else if (instruction.base != eCODE_STOP) {
+        body << "    goto dispatch;\n";
+      }
+    }
+    // Write out the translation unit.
+    out << "// ****************************************************************************\n";
+    out << "// " << name << " - Translated from C-Lesh. Do not edit.\n";
+    out << "// ****************************************************************************\n\n";
+    out << "#include \"C_Lesh.h\"\n\n";
+    out << "namespace Codeloader {\n\n";
+    out << "  static const sImage_Entry ENTRIES[] = {\n";
+    int offset = 0;
+    for (int table_index = 0; table_index < count; table_index++) {
+      sTable_Slot& table = (*this->memory)[this->program_start + table_index];
+      out << "    { " << table.width << ", " << table.height << ", " << offset << " },\n";
+      offset += table.width * table.height;
+    }
+    out << "  };\n\n";
+    out << "  static const int CELLS[] = {\n";
+    for (int table_index = 0; table_index < count; table_index++) {
+      sTable_Slot& table = (*this->memory)[this->program_start + table_index];
+      out << "   ";
+      for (int row_index = 0; row_index < table.height; row_index++) {
+        for (int col_index = 0; col_index < table.width; col_index++) {
+          out << " " << table.cells[(row_index * table.stride) + col_index] << ",";
+        }
+      }
+      out << "\n";
+    }
+    out << "    0\n";
+    out << "  };\n\n";
+    if (operands.size() > 0) {
+      out << "  // References and operands that are evaluated by C-Lesh.\n";
+      out << "  static sOperand OPERANDS[] = {\n";
+      for (int operand_index = 0; operand_index < (int)operands.size(); operand_index++) {
+        out << "    { " << Base_Mode(operands[operand_index].mode) << ", " << operands[operand_index].address << ", " << operands[operand_index].row << " },\n";
+      }
+      out << "  };\n\n";
+    }
+    out << "  /**\n";
+    out << "   * Runs the translated program from the command pointer.\n";
+    out << "   * @param clsh The C-Lesh processor.\n";
+    out << "   * @param count The maximum number of commands to run.\n";
+    out << "   * @return The number of commands that were run.\n";
+    out << "   * @throws An error if a command fails.\n";
+    out << "   */\n";
+    out << "  static int Run(cC_Lesh& clsh, int count) {\n";
+    out << "    int executed = 0;\n";
+    out << "    goto dispatch;\n";
+    out << body.str();
+    out << "    dispatch:\n";
+    out << "    if ((clsh.native == NULL) || (clsh.status != eSTATUS_RUNNING)) {\n";
+    out << "      return executed;\n";
+    out << "    }\n";
+    out << "    switch (clsh.command_pointer) {\n";
+    for (int instr_index = 0; instr_index < count; instr_index++) {
+      if (this->instructions[instr_index].decoded) {
+        int address = this->program_start + instr_index;
+        out << "      case " << address << ": goto cmd_" << address << ";\n";
+      }
+    }
+    out << "      default: return executed; // Not a command of the program.\n";
+    out << "    }\n";
+    out << "  }\n\n";
+    out << "  const sNative_Image NATIVE_PROGRAM = { \"" << name << "\", " << this->program_start << ", " << count << ", ENTRIES, CELLS, Run };\n\n";
+    out << "}\n";
+  }
+
+  /**
+   * Translates an expression to statements that leave its value in a variable.
+   * @param out The stream to write the statements to.
+   * @param expression The decoded expression.
+   * @param name The name of the variable.
+   * @param operands The operands that are evaluated by C-Lesh. Operands are added to it.
+   */
+  void cC_Lesh::Translate_Expression(std::ostream& out, sExpression& expression, std::string name, std::vector<sOperand>& operands) {
+    if (expression.constant) {
+      out << "      int " << name << " = " << expression.value << ";\n";
+      return;
+    }
+    sTerm* terms = &this->terms[expression.start];
+    out << "      int " << name << " = " << this->Translate_Operand(terms[0].operand, operands) << ";\n";
+    for (int term_index = 1; term_index < expression.count; term_index++) {
+      std::string operand = this->Translate_Operand(terms[term_index].operand, operands);
+      switch (terms[term_index].op) {
+        case eOPERATOR_ADD: {
+          out << "      " << name << " += " << operand << ";\n";
+          break;
+        }
+        case eOPERATOR_SUBTRACT: {
+          out << "      " << name << " -= " << operand << ";\n";
+          break;
+        }
+        case eOPERATOR_MULTIPLY: {
+          out << "      " << name << " *= " << operand << ";\n";
+          break;
+        }
+        default: {
+          out << "      " << name << " = clsh.Apply_Operator(" << terms[term_index].op << ", " << name << ", " << operand << ");\n";
+          break;
+        }
+      }
+    }
+  }
+
+  /**
+   * Translates an operand to a C++ expression. Values and immediate tables are read
+   * directly and everything else is evaluated by C-Lesh.
+   * @param operand The decoded operand.
+   * @param operands The operands that are evaluated by C-Lesh. The operand is added to it if needed.
+   * @return The C++ expression.
+   */
+  std::string cC_Lesh::Translate_Operand(sOperand& operand, std::vector<sOperand>& operands) {
+    if (operand.mode == eADDRESS_VALUE) {
+      return Number_To_Text(operand.address);
+    }
+    if (Base_Mode(operand.mode) == eADDRESS_IMMEDIATE) {
+      return "clsh.memory->Read_Scalar(" + Number_To_Text(operand.address) + ")";
+    }
+    operands.push_back(operand);
+    return "clsh.Eval_Operand(OPERANDS[" + Number_To_Text((int)operands.size() - 1) + "])";
+  }
+
+  /**
+   * Translates a jump to a fixed address. Addresses of commands go to their label and
+   * anything else goes through dispatch.
+   * @param address The address to jump to.
+   * @return The C++ statement.
+   */
+  std::string cC_Lesh::Translate_Jump(int address) {
+    if ((address >= this->program_start) && (address < this->program_end) && this->instructions[address - this->program_start].decoded) {
+      return "goto cmd_" + Number_To_Text(address) + ";";
+    }
+    return "goto dispatch;";
+  }
+
+  // **************************************************************************
+  // Evaluator
+  // **************************************************************************
+
+  /**
+   * Evaluates an expression and returns a number.
+   * @param expression The decoded expression.
+   * @return The result of the evaluation.
+   * @throws An error if the operator is invalid.
+   */
+  int cC_Lesh::Eval_Expression(sExpression& expression) {
+    if (expression.constant) {
+      return expression.value;
+    }
+    sTerm* terms = &this->terms[expression.start];
+    int result = this->Eval_Operand(terms[0].operand);
+    for (int term_index = 1; term_index < expression.count; term_index++) {
+      int operand_result = this->Eval_Operand(terms[term_index].operand);
+      C_LESH_PROFILE_OPERATOR_START();
+      result = this->Apply_Operator(terms[term_index].op, result, operand_result);
+      C_LESH_PROFILE_OPERATOR(terms[term_index].op);
+    }
+    return result;
+  }
+
+  /**
+   * Applies an operator to the result so far and an operand.
+   * @param op The operator.
+   * @param result The result so far.
+   * @param operand The value of the operand.
+   * @return The new result.
+   * @throws An error if the operator is invalid.
+   */
+  int cC_Lesh::Apply_Operator(int op, int result, int operand) {
+    switch (op) {
+      case eOPERATOR_ADD: {
+        result += operand;
+        break;
+      }
+      case eOPERATOR_SUBTRACT: {
+        result -= operand;
+        break;
+      }
+      case eOPERATOR_MULTIPLY: {
+        result *= operand;
+        break;
+      }
+      case eOPERATOR_DIVIDE: {
+        if (operand != 0) {
+          result /= operand;
+        }
+        break;
+      }
+      case eOPERATOR_REMAINDER: {
+        if (operand == 0) {
+          result = 0;
+        }
+        else {
+          result %= operand;
+        }
+        break;
+      }
+      case eOPERATOR_RANDOM: {
+        result = this->io->Get_Random_Number(result, operand);
+        break;
+      }
+      case eOPERATOR_COSINE: {
+        result = (int)((double)result * std::cos((double)operand * 3.15 / 180.0));
+        break;
+      }
+      case eOPERATOR_SINE: {
+        result = (int)((double)result * std::sin((double)operand * 3.15 / 180.0));
+        break;
+      }
+      case eOPERATOR_NONE: {
+        break; // Do nothing.
+      }
+      default: {
+        C_LESH_FAULT(this->memory, eFAULT_OPERATOR, 0, 0, op, "Invalid operator " + Number_To_Text(op) + ".");
+        break;
+      }
+    }
+    return result;
+  }
+
+  // Applies an arithmetic operator to cells four at a time with the vector extensions
+  // of GCC and Clang, which become SIMD instructions on every target. Cells that are
+  // left over, and every cell on other compilers, go one at a time.
+#if defined(__GNUC__)
+  typedef int tCell_Vector __attribute__((vector_size(16)));
+  #define C_LESH_VECTOR_LOOP(op) \
+    int cell_index = 0; \
+    for (; cell_index + 4 <= count; cell_index += 4) { \
+      tCell_Vector left_cells; \
+      tCell_Vector right_cells; \
+      std::memcpy(&left_cells, left + cell_index, sizeof(tCell_Vector)); \
+      std::memcpy(&right_cells, right + cell_index, sizeof(tCell_Vector)); \
+      left_cells = left_cells op right_cells; \
+      std::memcpy(result + cell_index, &left_cells, sizeof(tCell_Vector)); \
+    } \
+    for (; cell_index < count; cell_index++) { \
+      result[cell_index] = left[cell_index] op right[cell_index]; \
+    }
+#else
+  #define C_LESH_VECTOR_LOOP(op) \
+    for (int cell_index = 0; cell_index < count; cell_index++) { \
+      result[cell_index] = left[cell_index] op right[cell_index]; \
+    }
+#endif
+
+  /**
+   * Applies an operator to every pair of cells of two rows. The operator is picked once
+   * for the whole row. Division and remainder by zero work the same as in
+   * Apply_Operator().
+   * @param op The operator.
+   * @param result The cells to write the results to. They may be the same as a source.
+   * @param left The cells left of the operator.
+   * @param right The cells right of the operator.
+   * @param count The number of cells.
+   * @throws An error if the operator is invalid.
+   */
+  void cC_Lesh::Apply_Vector(int op, int* result, const int* left, const int* right, int count) {
+    switch (op) {
+      case eOPERATOR_ADD: {
+        C_LESH_VECTOR_LOOP(+);
+        break;
+      }
+      case eOPERATOR_SUBTRACT: {
+        C_LESH_VECTOR_LOOP(-);
+        break;
+      }
+      case eOPERATOR_MULTIPLY: {
+        C_LESH_VECTOR_LOOP(*);
+        break;
+      }
+      case eOPERATOR_DIVIDE: {
+        for (int cell_index = 0; cell_index < count; cell_index++) {
+          result[cell_index] = (right[cell_index] != 0) ? (left[cell_index] / right[cell_index]) : left[cell_index];
+        }
+        break;
+      }
+      case eOPERATOR_REMAINDER: {
+        for (int cell_index = 0; cell_index < count; cell_index++) {
+          result[cell_index] = (right[cell_index] != 0) ? (left[cell_index] % right[cell_index]) : 0;
+        }
+        break;
+      }
+      default: { // Random numbers and angles go one cell at a time.
+        for (int cell_index = 0; cell_index < count; cell_index++) {
+          result[cell_index] = this->Apply_Operator(op, left[cell_index], right[cell_index]);
+        }
+        break;
+      }
+    }
+  }
+  #undef C_LESH_VECTOR_LOOP
+
+  /**
+   * Evaluates an operand.
+   * @param operand The decoded operand.
+   * @return The result of the operand.
+   * @throws An error if the addressing mode is invalid.
+   */
+  int cC_Lesh::Eval_Operand(sOperand& operand) {
+    int result = 0;
+    switch (operand.mode) {
+      case eADDRESS_VALUE: {
+        result = operand.address;
+        break;
+      }
+      case eADDRESS_IMMEDIATE: {
+        result = this->memory->Read_Scalar(operand.address);
+        break;
+      }
+      case eADDRESS_POINTER: {
+        int ptr_value = this->memory->Read_Scalar(operand.address);
+        result = this->memory->Read_Scalar(ptr_value);
+        break;
+      }
+      case eADDRESS_STACK: {
+        int index = this->stack_pointer - operand.address - this->stack_start;
+        if ((unsigned int)index < (unsigned int)this->stack_size) {
+          result = this->stack_cells[index];
+        }
+        else {
+          result = this->memory->Read_Scalar(this->stack_pointer - operand.address); // Access variables in reverse.
+        }
+        break;
+      }
+      case eADDRESS_OBJECT_IMMEDIATE: {
+        result = this->memory->Read_Row(operand.address, operand.row);
+        break;
+      }
+      case eADDRESS_OBJECT_POINTER: {
+        int ptr_value = this->memory->Read_Scalar(operand.address);
+        result = this->memory->Read_Row(ptr_value, operand.row);
+        break;
+      }
+      case eADDRESS_VERIFIED_IMMEDIATE:
+      case eADDRESS_VERIFIED_OBJECT: {
+        result = this->memory->Read_Unchecked(operand.address, operand.row);
+        break;
+      }
+      default: {
+        throw cError("Invalid address mode " + Number_To_Text(operand.mode) + ".");
+      }
+    }
+    return result;
+  }
+
+  /**
+   * Evaluates a conditional expression.
+   * @param instruction The instruction containing the conditional expression.
+   * @return The result of the conditional.
+   * @throws An error if the logic operator is invalid.
+   */
+  int cC_Lesh::Eval_Conditional(sInstruction& instruction) {
+    sCondition* conditions = &this->conditions[instruction.cond_start];
+    int result = this->Eval_Condition(conditions[0]);
+    for (int cond_index = 1; cond_index < instruction.cond_count; cond_index++) {
+      int cond_result = this->Eval_Condition(conditions[cond_index]);
+      switch (conditions[cond_index - 1].logic) {
+        case eLOGIC_AND: {
+          result *= cond_result; // Multiply for AND.
+          break;
+        }
+        case eLOGIC_OR: {
+          result += cond_result; // Add for OR.
+          break;
+        }
+        case eLOGIC_NONE: {
+          break; // Do nothing.
+        }
+      }
+    }
+    return result;
+  }
+
+  /**
+   * Evaluates a condition.
+   * @param condition The decoded condition.
+   * @return The result of the condition test.
+   * @throws An error if the test is invalid.
+   */
+  int cC_Lesh::Eval_Condition(sCondition& condition) {
+    int left_operand = this->Eval_Expression(condition.left);
+    int right_operand = this->Eval_Expression(condition.right);
+    return this->Apply_Test(condition.test, left_operand, right_operand);
+  }
+
+  /**
+   * Applies a test to two values.
+   * @param test The test.
+   * @param left The left value.
+   * @param right The right value.
+   * @return The result of the test.
+   * @throws An error if the test is invalid.
+   */
+  int cC_Lesh::Apply_Test(int test, int left, int right) {
+    int result = 0;
+    int diff = right - left;
+    switch (test) {
+      case eTEST_EQUALS: {
+        result = (diff == 0);
+        break;
+      }
+      case eTEST_NOT: {
+        result = (diff != 0);
+        break;
+      }
+      case eTEST_LESS: {
+        result = (diff < 0);
+        break;
+      }
+      case eTEST_GREATER: {
+        result = (diff > 0);
+        break;
+      }
+      case eTEST_LESS_OR_EQUAL: {
+        result = (diff <= 0);
+        break;
+      }
+      case eTEST_GREATER_OR_EQUAL: {
+        result = (diff >= 0);
+        break;
+      }
+      default: {
+        throw cError("Invalid test operator " + Number_To_Text(test) + ".");
+      }
+    }
+    return result;
+  }
+
+  /**
+   * Resolves the memory address of the table a reference points to.
+   * @param reference The decoded table reference.
+   * @return The address of the table.
+   * @throws An error if the mode is invalid.
+   */
+  int cC_Lesh::Resolve_Address(sOperand& reference) {
+    int address = 0;
+    switch (reference.mode) {
+      case eADDRESS_VALUE: // The command itself.
+      case eADDRESS_IMMEDIATE:
+      case eADDRESS_OBJECT_IMMEDIATE:
+      case eADDRESS_VERIFIED_IMMEDIATE:
+      case eADDRESS_VERIFIED_OBJECT: {
+        address = reference.address;
+        break;
+      }
+      case eADDRESS_POINTER:
+      case eADDRESS_OBJECT_POINTER: {
+        address = this->memory->Read_Scalar(reference.address);
+        break;
+      }
+      case eADDRESS_STACK: {
+        address = this->stack_pointer - reference.address; // Access variables in reverse.
+        break;
+      }
+      default: {
+        C_LESH_FAULT(this->memory, eFAULT_MODE, reference.address, 0, reference.mode, "Invalid store mode " + Number_To_Text(reference.mode) + ".");
+        break;
+      }
+    }
+    return address;
+  }
+
+  /**
+   * Writes a value to the first column of the referenced row of a table. Verified
+   * references are written without checks.
+   * @param reference The decoded table reference.
+   * @param value The value to write.
+   * @throws An error if the mode is invalid.
+   */
+  void cC_Lesh::Write_Table_At_Address(sOperand& reference, int value) {
+    if (C_LESH_FAULTED()) {
+      return; // The value came from a faulted operand.
+    }
+    if ((reference.mode == eADDRESS_VERIFIED_IMMEDIATE) || (reference.mode == eADDRESS_VERIFIED_OBJECT)) {
+      this->memory->Write_Unchecked(reference.address, reference.row, value);
+      this->Invalidate(reference.address); // Code may have been modified.
+    }
+    else {
+      int address = this->Resolve_Address(reference);
+      if (C_LESH_FAULTED()) {
+        return;
+      }
+      this->memory->Write_Row(address, reference.row, value);
+      this->Invalidate(address); // Code may have been modified.
+    }
+  }
+
+  /**
+   * Reads the C-Lesh string a reference points to.
+   * @param reference The decoded table reference.
+   * @return The C++ string.
+   * @throws An error if the string is out of bounds.
+   */
+  std::string cC_Lesh::Read_String_At_Address(sOperand& reference) {
+    int address = this->Resolve_Address(reference);
+    if (C_LESH_FAULTED()) {
+      return "";
+    }
+    return this->C_Lesh_String_To_Cpp_String(address, reference.row);
+  }
+
+  // **************************************************************************
+  // Commands
+  // **************************************************************************
+
+  /**
+   * Executes the store command.
+   * @param instruction The decoded command.
+   * @throws An error if the store mode is invalid.
+   */
+  void cC_Lesh::Store(sInstruction& instruction) {
+    int result = this->Eval_Expression(instruction.exprs[0]);
+    this->Write_Table_At_Address(instruction.refs[0], result);
+  }
+
+  /**
+   * Dump the memory, stack, screen, pointers, and status.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::Dump(sInstruction& instruction) {
+    // Dump the pointers.
+    std::cout << "command=" << this->command_pointer << std::endl;
+    std::cout << "stack=" << this->stack_pointer << std::endl;
+    // Dump the status.
+    std::cout << "status=" << this->status << std::endl;
+    // Dump the memory.
+    cTable table(1, 1);
+    for (int table_index = 0; table_index < this->memory->count; table_index++) {
+      this->memory->Export(table_index, table);
+      table.Dump();
+    }
+    // Dump the screen.
+    this->pp->Dump();
+  }
+
+  /**
+   * Executes a test command.
+   * @param instruction The decoded command.
+   * @throws An error if the test command is missing something.
+   */
+  void cC_Lesh::Test(sInstruction& instruction) {
+    int result = this->Eval_Conditional(instruction);
+    int passed_address = this->Eval_Expression(instruction.exprs[0]);
+    int failed_address = this->Eval_Expression(instruction.exprs[1]);
+    C_LESH_CHECK_FAULT(); // No jump on a faulted operand.
+    if (passed_address != TAKE_NO_JUMP) {
+      if (result) {
+        this->command_pointer = passed_address;
+      }
+    }
+    if (failed_address != TAKE_NO_JUMP) {
+      if (!result) {
+        this->command_pointer = failed_address;
+      }
+    }
+  }
+
+  /**
+   * Executes a jump command.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::Jump(sInstruction& instruction) {
+    int address = this->Eval_Expression(instruction.exprs[0]);
+    C_LESH_CHECK_FAULT();
+    this->command_pointer = address;
+  }
+
+  /**
+   * Executes a call command.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::Call(sInstruction& instruction) {
+    // Push the command pointer to the stack.
+    this->Stack_Push(this->command_pointer);
+    C_LESH_CHECK_FAULT();
+    // Jump to location.
+    int address = this->Eval_Expression(instruction.exprs[0]);
+    C_LESH_CHECK_FAULT();
+    this->command_pointer = address;
+  }
+
+  /**
+   * Executes a push command.
+   * @param instruction The decoded command.
+   * @throws An error if there is no more stack space.
+   */
+  void cC_Lesh::Push(sInstruction& instruction) {
+    int value = this->Eval_Expression(instruction.exprs[0]);
+    this->Stack_Push(value);
+  }
+
+  /**
+   * Executes a pop command.
+   * @param instruction The decoded command.
+   * @throws An error if the stack pointer is out of bounds.
+   */
+  void cC_Lesh::Pop(sInstruction& instruction) {
+    int value = this->Stack_Pop();
+    this->Write_Table_At_Address(instruction.refs[0], value);
+  }
+
+  /**
+   * Executes a return command.
+   * @param instruction The decoded command.
+   * @throws An error if the stack is empty.
+   */
+  void cC_Lesh::Return(sInstruction& instruction) {
+    int address = this->Stack_Pop();
+    C_LESH_CHECK_FAULT();
+    this->command_pointer = address;
+  }
+
+  /**
+   * Loads a file from disk. Commands loaded over the program are decoded again.
+   * @param instruction The decoded command.
+   * @throws An error if the file mode is incorrect.
+   */
+  void cC_Lesh::Load(sInstruction& instruction) {
+    std::string name = this->Read_String_At_Address(instruction.refs[0]);
+    int mode = this->Eval_Expression(instruction.exprs[0]);
+    int address = this->Eval_Expression(instruction.exprs[1]);
+    int count = 0;
+    C_LESH_CHECK_FAULT();
+    switch (mode) {
+      case eFILE_LIST: {
+        count = this->Load_File_List(name, *this->memory, address);
+        break;
+      }
+      case eFILE_TABLE: {
+        count = this->Load_Table_List(name, *this->memory, address);
+        break;
+      }
+      case eFILE_IMAGE: {
+        count = this->memory->Load_Image(name, address);
+        break;
+      }
+      default: {
+        throw cError("Invalid file mode " + Number_To_Text(mode) + ".");
+      }
+    }
+    this->Decode_Range(address, count);
+    this->Check_Shapes(address, count);
+  }
+
+  /**
+   * Saves a file to disk.
+   * @param instruction The decoded command.
+   * @throws An error if the file could not be saved.
+   */
+  void cC_Lesh::Save(sInstruction& instruction) {
+    cTable object(1, 1);
+    int address = this->Resolve_Address(instruction.refs[0]);
+    C_LESH_CHECK_FAULT();
+    if (!this->memory->Check_Address(address)) {
+      return;
+    }
+    this->memory->Export(address, object);
+    std::string name = this->Read_String_At_Address(instruction.refs[1]);
+    C_LESH_CHECK_FAULT();
+    object.Save_To_File(name);
+  }
+
+  /**
+   * Executes an input command.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::Input(sInstruction& instruction) {
+    sSignal signal = this->io->Read_Signal();
+    this->Write_Table_At_Address(instruction.refs[0], signal.code);
+  }
+
+  /**
+   * Executes a refresh command.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::Refresh(sInstruction& instruction) {
+    if (this->frame_display && this->frame.indexed && (this->damage.screen_w > 0)) {
+      this->frame.Expand(this->damage.Get_Regions()); // Colors are looked up once per frame.
+    }
+    if (this->presenter) {
+      this->presenter->Publish(this->frame, this->damage);
+      this->frame_bytes = this->damage.Area() * C_LESH_PIXEL_BYTES;
+    }
+    else if (this->frame_display && (this->damage.screen_w > 0)) {
+      this->frame_display->Update_Frame(&this->frame, this->damage.Get_Regions());
+      this->frame_bytes = this->damage.Area() * C_LESH_PIXEL_BYTES;
+    }
+    else {
+      this->io->Update_Display(this->pp);
+      this->frame_bytes = (long long)this->damage.screen_w * this->damage.screen_h * C_LESH_PIXEL_BYTES;
+    }
+    this->uploaded_bytes += this->frame_bytes;
+    this->frames++;
+    this->damage.Reset();
+  }
+
+  /**
+   * Executes a sound command.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::Sound(sInstruction& instruction) {
+    std::string name = this->Read_String_At_Address(instruction.refs[0]);
+    C_LESH_CHECK_FAULT();
+    this->io->Play_Sound(name);
+  }
+
+  /**
+   * Executes a timeout command.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::Timeout(sInstruction& instruction) {
+    int delay = this->Eval_Expression(instruction.exprs[0]);
+    C_LESH_CHECK_FAULT();
+    this->io->Timeout(delay);
+  }
+
+  /**
+   * Executes an output command.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::Output(sInstruction& instruction) {
+    std::string output = this->Read_String_At_Address(instruction.refs[0]);
+    int x = this->Eval_Expression(instruction.exprs[0]);
+    int y = this->Eval_Expression(instruction.exprs[1]);
+    int red = this->Eval_Expression(instruction.exprs[2]);
+    int green = this->Eval_Expression(instruction.exprs[3]);
+    int blue = this->Eval_Expression(instruction.exprs[4]);
+    C_LESH_CHECK_FAULT();
+    if (this->frame_display && (this->atlas.height > 0)) {
+      uint32_t rgb = (uint32_t)(((red & 0xFF) << 16) | ((green & 0xFF) << 8) | (blue & 0xFF));
+      int color = this->frame.indexed ? this->frame.Find_Color(rgb) : (int)rgb;
+      sText_Image& text = this->text_cache.Get(this->atlas, output, color);
+      if (text.width > 0) {
+        this->frame.Blit(&text.cells[0], text.width, text.height, text.width, x, y, eDRAW_TRANSPARENT);
+        this->damage.Add(x, y, text.width, text.height);
+      }
+    }
+    else {
+      this->io->Output_Text(output, x, y, red, green, blue);
+    }
+  }
+
+  /**
+   * Executes a string command.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::String(sInstruction& instruction) {
+    std::string str_1 = this->Read_String_At_Address(instruction.refs[0]);
+    std::string str_2 = this->Read_String_At_Address(instruction.refs[1]);
+    bool test = (str_1 == str_2);
+    this->Write_Table_At_Address(instruction.refs[2], (int)test);
+  }
+
+  /**
+   * Executes a palette command. Indexed frames load the palette themselves and are
+   * presented through the frame display. Otherwise the picture processor loads it.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::Palette(sInstruction& instruction) {
+    std::string name = this->Read_String_At_Address(instruction.refs[0]);
+    C_LESH_CHECK_FAULT();
+    if (this->frame_display && this->frame.indexed) {
+      this->frame.Load_Palette(name + ".pal");
+    }
+    else {
+      this->pp->Load_Palette(name);
+    }
+    this->damage.Add_Screen(); // Every color may have changed.
+  }
+
+  /**
+   * Executes a draw command.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::Draw(sInstruction& instruction) {
+    int x = this->Eval_Expression(instruction.exprs[0]);
+    int y = this->Eval_Expression(instruction.exprs[1]);
+    int mode = this->Eval_Expression(instruction.exprs[2]);
+    int address = this->Resolve_Address(instruction.refs[0]);
+    C_LESH_CHECK_FAULT();
+    if (!this->memory->Check_Address(address)) {
+      return;
+    }
+    if (this->frame_display) {
+      if ((mode < eDRAW_OPAQUE) || (mode > eDRAW_FLIP_TRANSPARENT)) {
+        C_LESH_FAULT(this->memory, eFAULT_MODE, address, 0, mode, "Invalid draw mode " + Number_To_Text(mode) + ".");
+        return;
+      }
+      sTable_Slot& table = (*this->memory)[address];
+      this->frame.Blit(table.cells, table.width, table.height, table.stride, x, y, mode);
+      this->damage.Add(x, y, table.width, table.height);
+    }
+    else {
+      cTable& picture = this->memory->Get_Picture(address);
+      this->pp->Draw_Picture(picture, x, y, mode);
+      this->damage.Add(x, y, picture.width, picture.height);
+    }
+  }
+
+  /**
+   * Executes a clear command.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::Clear(sInstruction& instruction) {
+    sColor color;
+    color.red = this->Eval_Expression(instruction.exprs[0]);
+    color.green = this->Eval_Expression(instruction.exprs[1]);
+    color.blue = this->Eval_Expression(instruction.exprs[2]);
+    C_LESH_CHECK_FAULT();
+    if (this->frame_display) {
+      this->frame.Clear((uint32_t)(((color.red & 0xFF) << 16) | ((color.green & 0xFF) << 8) | (color.blue & 0xFF)));
+    }
+    else {
+      this->pp->Clear_Screen(color);
+    }
+    this->damage.Add_Screen();
+  }
+
+  /**
+   * Executes a resize command.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::Resize(sInstruction& instruction) {
+    int width = this->Eval_Expression(instruction.exprs[0]);
+    int height = this->Eval_Expression(instruction.exprs[1]);
+    int address = this->Resolve_Address(instruction.refs[0]);
+    C_LESH_CHECK_FAULT();
+    this->memory->Resize(address, width, height);
+    C_LESH_CHECK_FAULT();
+    this->Invalidate(address);
+    this->Check_Shapes(address, 1);
+  }
+
+  /**
+   * Executes a column command.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::Column(sInstruction& instruction) {
+    int index = this->Eval_Expression(instruction.exprs[0]);
+    int address = this->Resolve_Address(instruction.refs[0]);
+    C_LESH_CHECK_FAULT();
+    sCell cell;
+    if (this->memory->Locate(address, instruction.refs[0].row, index, cell)) {
+      this->Write_Table_At_Address(instruction.refs[1], this->memory->Read_Cell(cell, 0));
+    }
+  }
+
+  /**
+   * Executes a stop command.
+   * @param instruction The decoded command.
+   */
+  void cC_Lesh::Stop(sInstruction& instruction) {
+    this->status = eSTATUS_DONE;
+#ifdef C_LESH_PROFILE
+    this->Write_Profile(this->program_name);
+#endif
+    if (this->sample_interval > 0) {
+      this->Write_Stacks(this->program_name);
+    }
+  }
+
+  /**
+   * Executes a copy command. A range of tables is copied over another range, sizes
+   * included.
+   * @param instruction The decoded command.
+   * @throws An error if either range does not fit in memory.
+   */
+  void cC_Lesh::Copy(sInstruction& instruction) {
+    int count = this->Eval_Expression(instruction.exprs[0]);
+    int destination = this->Resolve_Address(instruction.refs[0]);
+    int source = this->Resolve_Address(instruction.refs[1]);
+    C_LESH_CHECK_FAULT();
+    this->memory->Copy(destination, source, count);
+    C_LESH_CHECK_FAULT();
+    this->Invalidate_Range(destination, count);
+    this->Check_Shapes(destination, count);
+  }
+
+  /**
+   * Executes a block command. A rectangle of cells is copied from one table to another.
+   * @param instruction The decoded command.
+   * @throws An error if a table is invalid.
+   */
+  void cC_Lesh::Block(sInstruction& instruction) {
+    int dest_x = this->Eval_Expression(instruction.exprs[0]);
+    int dest_y = this->Eval_Expression(instruction.exprs[1]);
+    int source_x = this->Eval_Expression(instruction.exprs[2]);
+    int source_y = this->Eval_Expression(instruction.exprs[3]);
+    int width = this->Eval_Expression(instruction.exprs[4]);
+    int height = this->Eval_Expression(instruction.exprs[5]);
+    int destination = this->Resolve_Address(instruction.refs[0]);
+    int source = this->Resolve_Address(instruction.refs[1]);
+    C_LESH_CHECK_FAULT();
+    this->memory->Copy_Block(destination, dest_x, dest_y, source, source_x, source_y, width, height);
+    C_LESH_CHECK_FAULT();
+    this->Invalidate(destination);
+  }
+
+  /**
+   * Executes a fill command. Every cell of a range of tables is set to a value.
+   * @param instruction The decoded command.
+   * @throws An error if the range does not fit in memory.
+   */
+  void cC_Lesh::Fill(sInstruction& instruction) {
+    int value = this->Eval_Expression(instruction.exprs[0]);
+    int count = this->Eval_Expression(instruction.exprs[1]);
+    int address = this->Resolve_Address(instruction.refs[0]);
+    C_LESH_CHECK_FAULT();
+    this->memory->Fill(address, count, value);
+    C_LESH_CHECK_FAULT();
+    this->Invalidate_Range(address, count);
+  }
+
+  /**
+   * Executes a vector command. An operator is applied to every pair of cells of two
+   * tables of the same size and the results go to a table that takes on that size.
+   * @param instruction The decoded command.
+   * @throws An error if the tables are not the same size or the operator is invalid.
+   */
+  void cC_Lesh::Vector(sInstruction& instruction) {
+    int op = this->Eval_Expression(instruction.exprs[0]);
+    int destination = this->Resolve_Address(instruction.refs[0]);
+    int left = this->Resolve_Address(instruction.refs[1]);
+    int right = this->Resolve_Address(instruction.refs[2]);
+    C_LESH_CHECK_FAULT();
+    if (!this->memory->Check_Address(destination) || !this->memory->Check_Address(left) || !this->memory->Check_Address(right)) {
+      return;
+    }
+    sTable_Slot& left_table = (*this->memory)[left];
+    sTable_Slot& right_table = (*this->memory)[right];
+    if ((left_table.width != right_table.width) || (left_table.height != right_table.height)) {
+      C_LESH_FAULT(this->memory, eFAULT_SIZE, right, right_table.height, right_table.width, "Tables " + Number_To_Text(left) + " and " + Number_To_Text(right) + " are not the same size.");
+      return;
+    }
+    if ((op < eOPERATOR_NONE) || (op > eOPERATOR_SINE)) { // Checked before anything is written.
+      C_LESH_FAULT(this->memory, eFAULT_OPERATOR, 0, 0, op, "Invalid operator " + Number_To_Text(op) + ".");
+      return;
+    }
+    sTable_Slot& table = (*this->memory)[destination];
+    if ((table.width != left_table.width) || (table.height != left_table.height)) {
+      this->memory->Resize(destination, left_table.width, left_table.height);
+      C_LESH_CHECK_FAULT();
+    }
+    if ((table.stride == table.width) && (left_table.stride == left_table.width) && (right_table.stride == right_table.width)) {
+      this->Apply_Vector(op, table.cells, left_table.cells, right_table.cells, table.width * table.height);
+    }
+    else {
+      for (int row_index = 0; row_index < table.height; row_index++) {
+        this->Apply_Vector(op, table.cells + (row_index * table.stride), left_table.cells + (row_index * left_table.stride),
+          right_table.cells + (row_index * right_table.stride), table.width);
+      }
+    }
+    table.stamp++;
+    C_LESH_PROFILE_READ(left);
+    C_LESH_PROFILE_READ(right);
+    C_LESH_PROFILE_WRITE(destination);
+    this->Invalidate(destination);
+    this->Check_Shapes(destination, 1);
+  }
+
+  /**
+   * Runs a fused command. The commands after the first are run from the instruction
+   * stream without going through dispatch. If one of them was changed since the
+   * program was fused, a command jumps or the limit is reached, the rest of the run is
+   * left to dispatch.
+   * @param instruction The first command of the run.
+   * @param limit The maximum number of commands to run.
+   * @return The number of commands that were run.
+   * @throws An error if a command fails.
+   */
+  int cC_Lesh::Run_Fused(sInstruction& instruction, int limit) {
+    int address = this->command_pointer - 1;
+    int last = (instruction.code == eCODE_PUSH_CALL) ? eCODE_CALL : ((instruction.code == eCODE_INCREMENT_TEST) ? eCODE_TEST : eCODE_POP);
+    this->Run_Resolved(instruction, instruction);
+    for (int command_index = 1; command_index < instruction.fused_count; command_index++) {
+      sInstruction& command = this->instructions[address + command_index - this->program_start];
+      int expected = (command_index == instruction.fused_count - 1) ? last : instruction.base;
+      if ((command_index >= limit) || (this->command_pointer != address + command_index) || !command.decoded ||
+        (command.base != expected) || C_LESH_FAULTED()) {
+        return command_index;
+      }
+      C_LESH_PROFILE_COMMAND(this->command_pointer, command.base);
+      this->command_pointer++;
+      this->Run_Resolved(instruction, command);
+    }
+    this->fusion_hits[instruction.code - eCODE_INCREMENT_TEST]++;
+    return instruction.fused_count;
+  }
+
+  /**
+   * Runs one command of a fused run with the tables that were resolved when it was
+   * fused. Immediate operands are read and written at their origin directly and the
+   * test of an increment test compares the new value of the table. Anything else
+   * goes through the handler of the command. Written references have to still be
+   * verified, since the table may have lost its cells since.
+   * @param first The first command of the run.
+   * @param command The command to run.
+   * @throws An error if the command fails.
+   */
+  void cC_Lesh::Run_Resolved(sInstruction& first, sInstruction& command) {
+    switch (command.base) {
+      case eCODE_STORE: {
+        if (command.fused_slot && (command.refs[0].mode == eADDRESS_VERIFIED_IMMEDIATE)) {
+          sTable_Slot& table = *command.fused_slot;
+          C_LESH_PROFILE_OPERATOR_START();
+          table.cells[0] = (int)((unsigned int)table.cells[0] + (unsigned int)command.fused_value);
+          C_LESH_PROFILE_OPERATOR(this->terms[command.exprs[0].start + 1].op);
+          table.stamp++;
+          C_LESH_PROFILE_READ(command.refs[0].address);
+          C_LESH_PROFILE_WRITE(command.refs[0].address);
+          this->Invalidate(command.refs[0].address); // Code may have been modified.
+        }
+        else {
+          this->Store(command);
+        }
+        break;
+      }
+      case eCODE_TEST: {
+        if (first.fused_test && (first.refs[0].mode == eADDRESS_VERIFIED_IMMEDIATE)) {
+          sCondition& condition = this->conditions[command.cond_start];
+          int value = first.fused_slot->cells[0];
+          int left = condition.left.constant ? condition.left.value : value;
+          int right = condition.right.constant ? condition.right.value : value;
+#ifdef C_LESH_PROFILE
+          for (int side_index = (int)condition.left.constant + (int)condition.right.constant; side_index < 2; side_index++) {
+            C_LESH_PROFILE_READ(first.refs[0].address);
+          }
+#endif
+          int target = this->Apply_Test(condition.test, left, right) ? command.exprs[0].value : command.exprs[1].value;
+          if (target != TAKE_NO_JUMP) {
+            this->command_pointer = target;
+          }
+        }
+        else {
+          this->Test(command);
+        }
+        break;
+      }
+      case eCODE_PUSH: {
+        if (command.exprs[0].constant) {
+          this->Stack_Push(command.exprs[0].value);
+        }
+        else if (command.fused_slot) {
+          C_LESH_PROFILE_READ(this->terms[command.exprs[0].start].operand.address);
+          this->Stack_Push(command.fused_slot->cells[0]);
+        }
+        else {
+          this->Push(command);
+        }
+        break;
+      }
+      case eCODE_POP: {
+        if (command.fused_slot && (command.refs[0].mode == eADDRESS_VERIFIED_IMMEDIATE)) {
+          int value = this->Stack_Pop();
+          if (!C_LESH_FAULTED()) {
+            sTable_Slot& table = *command.fused_slot;
+            table.cells[0] = value;
+            table.stamp++;
+            C_LESH_PROFILE_WRITE(command.refs[0].address);
+            this->Invalidate(command.refs[0].address); // Code may have been modified.
+          }
+        }
+        else {
+          this->Pop(command);
+        }
+        break;
+      }
+      default: {
+        (this->*HANDLERS[command.base])(command);
+      }
+    }
+  }
+
+  /**
+   * Pushes a value on the stack. A stack of a fixed size is written directly.
+   * @param value The value to push.
+   * @throws An error if there is no more stack space.
+   */
+  void cC_Lesh::Stack_Push(int value) {
+    if (C_LESH_FAULTED()) {
+      return; // The value came from a faulted operand.
+    }
+    if (this->stack_cells) {
+      int index = this->stack_pointer - this->stack_start;
+      if ((unsigned int)index >= (unsigned int)this->stack_size) {
+        C_LESH_FAULT(this->memory, eFAULT_STACK_OVERFLOW, this->stack_pointer, 0, 0, "Stack overflow at command " + Number_To_Text(this->command_pointer - 1) + ".");
+        return;
+      }
+      this->stack_cells[index] = value;
+      this->memory->Slot(this->stack_pointer).stamp++;
+    }
+    else {
+      this->memory->Write_Scalar(this->stack_pointer, value);
+    }
+    this->Invalidate(this->stack_pointer);
+    this->stack_pointer++;
+  }
+
+  /**
+   * Pops a value from the stack.
+   * @return The value at the top of the stack.
+   * @throws An error if the stack is empty.
+   */
+  int cC_Lesh::Stack_Pop() {
+    int value = 0;
+    if (this->stack_cells) {
+      int index = this->stack_pointer - this->stack_start - 1;
+      if ((unsigned int)index >= (unsigned int)this->stack_size) {
+        C_LESH_FAULT(this->memory, eFAULT_STACK_UNDERFLOW, this->stack_pointer - 1, 0, 0, "Stack underflow at command " + Number_To_Text(this->command_pointer - 1) + ".");
+        return 0;
+      }
+      value = this->stack_cells[index];
+    }
+    else {
+      value = this->memory->Read_Scalar(this->stack_pointer - 1);
+      if (C_LESH_FAULTED()) {
+        return 0; // The stack stays where it was, as with an error.
+      }
+    }
+    this->stack_pointer--;
+    return value;
+  }
+
+  /**
+   * Loads a file into memory.
+   * @param name The name of the file to load.
+   * @param memory The memory to load the file into.
+   * @param address The address to load the file into.
+   * @return The number of tables loaded.
+   * @throws An error if the file could not be loaded.
+   */
+  int cC_Lesh::Load_File_List(std::string name, cMemory& memory, int address) {
+    cFile file(name);
+    int count = 0;
+    file.Read();
+    while (file.Has_More_Lines()) {
+      std::string fname = file.Get_Line();
+      cTable table(1, 1);
+      table.Load_From_File(fname);
+      if (!memory.Import(address + count, table)) {
+        break;
+      }
+      count++;
+    }
+    return count;
+  }
+
+  /**
+   * Loads a list of tables from a single file.
+   * @param name The name of the file to load the tables from.
+   * @param memory The memory to load the tables to.
+   * @param address The address to load the tables to.
+   * @return The number of tables loaded.
+   * @throws An error if the tables could not be loaded.
+   */
+  int cC_Lesh::Load_Table_List(std::string name, cMemory& memory, int address) {
+    std::vector<sImage_Entry> entries;
+    std::vector<int> cells;
+    Parse_Table_List(name, entries, cells);
+    int count = (int)entries.size();
+    for (int table_index = 0; table_index < count; table_index++) {
+      sImage_Entry& entry = entries[table_index];
+      if (!memory.Resize(address + table_index, entry.width, entry.height)) {
+        return table_index; // Only the tables before the fault were loaded.
+      }
+      sTable_Slot& table = memory[address + table_index];
+      std::copy(cells.begin() + entry.offset, cells.begin() + entry.offset + (entry.width * entry.height), table.cells);
+      table.stamp++;
+    }
+    return count;
+  }
+
+  /**
+   * Parses a list of tables from a single file into a table directory and packed cells.
+   * @param name The name of the file to parse.
+   * @param entries The directory to fill in. Offsets are indexes into the cells.
+   * @param cells The packed cells of all the tables.
+   * @throws An error if the tables could not be parsed.
+   */
+  void cC_Lesh::Parse_Table_List(std::string name, std::vector<sImage_Entry>& entries, std::vector<int>& cells) {
+    cFile file(name);
+    file.Read();
+    while (file.Has_More_Lines()) {
+      // Read dimensions of table.
+      std::string dimensions = file.Get_Line();
+      cArray<std::string> pair = Parse_Sausage_Text(dimensions, "x");
+      if (pair.Count() == 2) {
+        sImage_Entry entry;
+        entry.width = Text_To_Number(pair[0]);
+        entry.height = Text_To_Number(pair[1]);
+        entry.offset = (int)cells.size();
+        if ((entry.width < 0) || (entry.height < 0)) {
+          throw cError("Invalid table size in " + name + ".");
+        }
+        cells.resize(cells.size() + (entry.width * entry.height), 0);
+        for (int row_index = 0; row_index < entry.height; row_index++) {
+          std::string line = file.Get_Line();
+          cArray<std::string> columns = Parse_Sausage_Text(line, " ");
+          int column_count = columns.Count();
+          if (column_count > entry.width) {
+            throw cError("Too many columns in table of " + name + ".");
+          }
+          for (int column_index = 0; column_index < column_count; column_index++) {
+            cells[entry.offset + (row_index * entry.width) + column_index] = Text_To_Number(columns[column_index]);
+          }
+        }
+        entries.push_back(entry);
+      }
+      else {
+        throw cError("Missing width or height of table in " + name + ".");
+      }
+    }
+  }
+
+  /**
+   * Parses a list of table files into a table directory and packed cells.
+   * @param name The name of the file listing the table files.
+   * @param entries The directory to fill in. Offsets are indexes into the cells.
+   * @param cells The packed cells of all the tables.
+   * @throws An error if a table could not be loaded.
+   */
+  void cC_Lesh::Parse_File_List(std::string name, std::vector<sImage_Entry>& entries, std::vector<int>& cells) {
+    cFile file(name);
+    file.Read();
+    while (file.Has_More_Lines()) {
+      std::string fname = file.Get_Line();
+      cTable table(1, 1);
+      table.Load_From_File(fname);
+      sImage_Entry entry;
+      entry.width = table.width;
+      entry.height = table.height;
+      entry.offset = (int)cells.size();
+      table.Rewind();
+      for (int row_index = 0; row_index < entry.height; row_index++) {
+        for (int col_index = 0; col_index < entry.width; col_index++) {
+          cells.push_back(table.Read_Column());
+        }
+        table.Move_To_Next_Row();
+      }
+      entries.push_back(entry);
+    }
+  }
+
+  /**
+   * Saves tables as a binary image. The image has a header, a directory with the size
+   * and byte offset of every table, and then the packed cells of all the tables.
+   * @param name The name of the image file.
+   * @param entries The table directory. Offsets are indexes into the cells.
+   * @param cells The packed cells of all the tables.
+   * @throws An error if the image could not be saved.
+   */
+  void cC_Lesh::Save_Image(std::string name, std::vector<sImage_Entry>& entries, std::vector<int>& cells) {
+    std::ofstream image(name, std::ios::binary);
+    if (!image) {
+      throw cError("Could not save image " + name + ".");
+    }
+    sImage_Header header;
+    header.magic = eIMAGE_MAGIC;
+    header.version = eIMAGE_VERSION;
+    header.count = (int32_t)entries.size();
+    header.reserved = 0;
+    image.write((const char*)&header, sizeof(header));
+    int32_t payload = (int32_t)(sizeof(sImage_Header) + (entries.size() * sizeof(sImage_Entry)));
+    for (size_t entry_index = 0; entry_index < entries.size(); entry_index++) {
+      sImage_Entry entry = entries[entry_index];
+      entry.offset = payload + (entry.offset * (int32_t)sizeof(int32_t));
+      image.write((const char*)&entry, sizeof(entry));
+    }
+    for (size_t cell_index = 0; cell_index < cells.size(); cell_index++) {
+      int32_t cell = cells[cell_index];
+      image.write((const char*)&cell, sizeof(cell));
+    }
+    if (!image) {
+      throw cError("Could not write image " + name + ".");
+    }
+  }
+
+  /**
+   * Extracts a C-Lesh string and converts it to a C++ string.
+   * @param address The address of the table containing the string.
+   * @param row The row where the string is.
+   * @return The C++ string.
+   * @throws An error if the string is out of bounds.
+   */
+  std::string cC_Lesh::C_Lesh_String_To_Cpp_String(int address, int row) {
+    std::string text = "";
+    sCell cell;
+    if (!this->memory->Locate(address, row, 0, cell)) {
+      return text;
+    }
+    int letter_count = this->memory->Read_Cell(cell, 0);
+    if (letter_count >= cell.slot->width) { // Check the whole row once.
+      C_LESH_FAULT(this->memory, eFAULT_CELL, address, row, cell.slot->width, "Invalid cell " + Number_To_Text(cell.slot->width) + "," + Number_To_Text(row) + " accessed at " + Number_To_Text(address) + ".");
+      return text;
+    }
+    for (int letter_index = 1; letter_index <= letter_count; letter_index++) {
+      int letter = this->memory->Read_Cell(cell, letter_index);
+      if (letter == '@') { // Placeholder
+        int number = this->Stack_Pop();
+        text += Number_To_Text(number); // Replace with number.
+      }
+      else {
+        text += (char)letter;
+      }
+    }
+    return text;
+  }
+
+  // **************************************************************************
+  // Memory Implmentation
+  // **************************************************************************
+
+  /**
+   * Creates a new memory module of the specified size. Tables of the default size
+   * are laid out back to back in a single arena. The arena is mapped as zero pages,
+   * so tables take up no memory until they are first written.
+   * @param count The number of tables in memory.
+   * @param width The width of each table.
+   * @param height The height of each table.
+   */
+  cMemory::cMemory(int count, int width, int height) {
+    this->count = count;
+    this->table_w = width;
+    this->table_h = height;
+    this->table_size = std::max(width * height, 1);
+    this->arena_size = (size_t)std::max(count, 1) * this->table_size * sizeof(int);
+    this->slots_size = (size_t)std::max(count, 1) * sizeof(sTable_Slot);
+    this->Map_Arena();
+    this->touched.assign(((std::max(count, 1) - 1) >> C_LESH_SLOT_SHIFT) + 1, 0); // Slots are set up on first touch.
+    this->stack = NULL;
+    this->stack_address = 0;
+    this->stack_count = 0;
+    this->Clear_Fault();
+#ifdef C_LESH_PROFILE
+    this->profiler = NULL;
+#endif
+  }
+
+  /**
+   * Frees the memory module.
+   */
+  cMemory::~cMemory() {
+    for (int chunk_index = 0; chunk_index < (int)this->touched.size(); chunk_index++) {
+      int end = std::min((chunk_index + 1) << C_LESH_SLOT_SHIFT, this->count);
+      for (int table_index = chunk_index << C_LESH_SLOT_SHIFT; this->touched[chunk_index] && (table_index < end); table_index++) {
+        if (this->Is_Spilled(table_index)) {
+          delete[] this->slots[table_index].cells;
+        }
+      }
+    }
+    for (size_t pool_index = 0; pool_index < this->pools.size(); pool_index++) {
+      delete[] this->pools[pool_index].cells;
+    }
+    this->Unmap_Arena();
+    if (this->stack) {
+      delete[] this->stack;
+    }
+    for (std::map<int, sPicture>::iterator picture = this->pictures.begin(); picture != this->pictures.end(); ++picture) {
+      delete picture->second.table;
+    }
+    for (size_t image_index = 0; image_index < this->images.size(); image_index++) {
+      delete this->images[image_index];
+    }
+  }
+
+  /**
+   * Clears out the memory. Slots that were never touched are already clear.
+   */
+  void cMemory::Clear() {
+    this->Zero_Arena();
+    for (int chunk_index = 0; chunk_index < (int)this->touched.size(); chunk_index++) {
+      int end = std::min((chunk_index + 1) << C_LESH_SLOT_SHIFT, this->count);
+      for (int table_index = chunk_index << C_LESH_SLOT_SHIFT; this->touched[chunk_index] && (table_index < end); table_index++) {
+        sTable_Slot& slot = this->slots[table_index];
+        if ((slot.cells != this->arena + (table_index * this->table_size)) && !this->Is_Pooled(table_index)) {
+          std::fill(slot.cells, slot.cells + std::max(slot.width * slot.height, 1), 0);
+        }
+        slot.stamp++;
+      }
+    }
+    for (size_t pool_index = 0; pool_index < this->pools.size(); pool_index++) {
+      sPool& pool = this->pools[pool_index];
+      std::fill(pool.cells, pool.cells + std::max(pool.count * pool.height, 1), 0);
+    }
+  }
+
+  /**
+   * Maps the arena and the slots. Fresh pages read as zero and are only backed by
+   * memory once they are written to.
+   * @throws An error if the arena or the slots could not be mapped.
+   */
+  void cMemory::Map_Arena() {
+    this->arena = (int*)this->Map_Pages(this->arena_size);
+    this->slots = (sTable_Slot*)this->Map_Pages(this->slots_size);
+  }
+
+  /**
+   * Maps pages of memory that read as zero.
+   * @param size The number of bytes to map.
+   * @return The pages.
+   * @throws An error if the pages could not be mapped.
+   */
+  void* cMemory::Map_Pages(size_t size) {
+#ifdef _WIN32
+    void* pages = VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (pages == NULL) {
+      throw cError("Could not allocate memory of " + Number_To_Text(this->count) + " tables.");
+    }
+#else
+    void* pages = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pages == MAP_FAILED) {
+      throw cError("Could not allocate memory of " + Number_To_Text(this->count) + " tables.");
+    }
+#endif
+    return pages;
+  }
+
+  /**
+   * Zeroes the arena by handing its pages back, so tables that were written take up no
+   * memory again. The arena stays at the same address.
+   * @throws An error if the arena could not be mapped again.
+   */
+  void cMemory::Zero_Arena() {
+#ifdef _WIN32
+    VirtualFree(this->arena, this->arena_size, MEM_DECOMMIT);
+    if (VirtualAlloc(this->arena, this->arena_size, MEM_COMMIT, PAGE_READWRITE) == NULL) {
+      throw cError("Could not clear memory.");
+    }
+#else
+    if (mmap(this->arena, this->arena_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+      throw cError("Could not clear memory.");
+    }
+#endif
+  }
+
+  /**
+   * Unmaps the arena and the slots.
+   */
+  void cMemory::Unmap_Arena() {
+#ifdef _WIN32
+    VirtualFree(this->arena, 0, MEM_RELEASE);
+    VirtualFree(this->slots, 0, MEM_RELEASE);
+#else
+    munmap(this->arena, this->arena_size);
+    munmap(this->slots, this->slots_size);
+#endif
+  }
+
+  /**
+   * Accesses a table from memory given an address.
+   * @param address The address of the table to access.
+   * @return A reference to the table at the address.
+   * @throws An error if the address is invalid.
+   */
+  sTable_Slot& cMemory::operator[](int address) {
+    if ((address < 0) || (address >= this->count)) {
+      throw cError("Invalid address accessed at " + Number_To_Text(address) + ".");
+    }
+    return this->Slot(address);
+  }
+
+  /**
+   * Gets the slot of a table that is known to be in memory. The chunk of slots around
+   * it is set up the first time one of them is touched.
+   * @param address The address of the table.
+   * @return The slot of the table.
+   */
+  sTable_Slot& cMemory::Slot(int address) {
+    if (!this->touched[address >> C_LESH_SLOT_SHIFT]) {
+      this->Touch(address);
+    }
+    return this->slots[address];
+  }
+
+  /**
+   * Sets up the chunk of slots around a table. Each table starts out with the default
+   * size and its cells in the arena.
+   * @param address The address of the table.
+   */
+  void cMemory::Touch(int address) {
+    int chunk_index = address >> C_LESH_SLOT_SHIFT;
+    int end = std::min((chunk_index + 1) << C_LESH_SLOT_SHIFT, this->count);
+    for (int table_index = chunk_index << C_LESH_SLOT_SHIFT; table_index < end; table_index++) {
+      sTable_Slot& slot = this->slots[table_index];
+      slot.cells = this->arena + (table_index * this->table_size);
+      slot.width = this->table_w;
+      slot.height = this->table_h;
+      slot.stride = this->table_w;
+      slot.stamp = 0;
+      slot.image = NULL;
+    }
+    this->touched[chunk_index] = 1;
+  }
+
+  /**
+   * Checks that an address is in memory before a command looks up its table.
+   * @param address The address of the table.
+   * @return True if the address is valid, false if a fault was raised.
+   * @throws An error if the address is invalid.
+   */
+  bool cMemory::Check_Address(int address) {
+    if ((address < 0) || (address >= this->count)) {
+      C_LESH_FAULT(this, eFAULT_ADDRESS, address, 0, 0, "Invalid address accessed at " + Number_To_Text(address) + ".");
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Determines if a table has been moved out of the arena by a resize.
+   * @param address The address of the table.
+   * @return True if the table has its own storage, false otherwise.
+   */
+  bool cMemory::Is_Spilled(int address) {
+    sTable_Slot& slot = this->Slot(address);
+    return ((slot.cells != this->arena + (address * this->table_size)) && (slot.image == NULL) && !this->Is_Stack(address) &&
+      !this->Is_Pooled(address));
+  }
+
+  /**
+   * Determines if a table is part of the stack.
+   * @param address The address of the table.
+   * @return True if the table is a cell of the stack, false otherwise.
+   */
+  bool cMemory::Is_Stack(int address) {
+    return ((address >= this->stack_address) && (address < this->stack_address + this->stack_count));
+  }
+
+  /**
+   * Backs a run of tables with a single array of cells that is used as the stack. The
+   * tables become single cells so the stack can still be read and written as tables.
+   * @param address The address of the first table of the stack.
+   * @param count The number of tables in the stack.
+   * @return The cells of the stack.
+   * @throws An error if the stack does not fit in memory.
+   */
+  int* cMemory::Map_Stack(int address, int count) {
+    if ((address < 0) || (count < 0) || (address + count > this->count)) {
+      throw cError("Stack of " + Number_To_Text(count) + " does not fit at address " + Number_To_Text(address) + ".");
+    }
+    int* stack = new int[std::max(count, 1)]();
+    for (int table_index = 0; table_index < count; table_index++) {
+      sTable_Slot& slot = this->Slot(address + table_index);
+      this->Release(address + table_index);
+      slot.cells = stack + table_index;
+      slot.width = 1;
+      slot.height = 1;
+      slot.stride = 1;
+      slot.stamp++;
+    }
+    this->stack = stack;
+    this->stack_address = address;
+    this->stack_count = count;
+    return stack;
+  }
+
+  /**
+   * Determines if a table is an object in a pool.
+   * @param address The address of the table.
+   * @return True if the table is stored in a pool, false otherwise.
+   */
+  bool cMemory::Is_Pooled(int address) {
+    for (size_t pool_index = 0; pool_index < this->pools.size(); pool_index++) {
+      sPool& pool = this->pools[pool_index];
+      if ((address >= pool.address) && (address < pool.address + pool.count)) {
+        return (this->Slot(address).cells == pool.cells + (address - pool.address));
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Stores a run of objects of the same type property by property. The properties of
+   * all the objects are laid out one after the other, so a loop over the objects reads
+   * memory in order. The tables keep their addresses and their rows are reached with
+   * a stride of the object count, so objects are still accessed through pointers.
+   * @param address The address of the first object.
+   * @param count The number of objects.
+   * @param height The number of properties of each object.
+   * @throws An error if the objects do not fit or are not all one property wide.
+   */
+  void cMemory::Map_Pool(int address, int count, int height) {
+    if ((address < 0) || (count < 0) || (height < 0) || (address + count > this->count)) {
+      throw cError("Pool of " + Number_To_Text(count) + " does not fit at address " + Number_To_Text(address) + ".");
+    }
+    if ((address < this->stack_address + this->stack_count) && (address + count > this->stack_address)) {
+      throw cError("Pool at " + Number_To_Text(address) + " overlaps the stack.");
+    }
+    for (int object_index = 0; object_index < count; object_index++) {
+      sTable_Slot& slot = this->Slot(address + object_index);
+      if ((slot.width != 1) || (slot.height != height) || this->Is_Pooled(address + object_index)) {
+        throw cError("Table at " + Number_To_Text(address + object_index) + " is not an object with " + Number_To_Text(height) + " properties.");
+      }
+    }
+    sPool pool;
+    pool.cells = new int[std::max(count * height, 1)]();
+    pool.address = address;
+    pool.count = count;
+    pool.height = height;
+    for (int object_index = 0; object_index < count; object_index++) {
+      sTable_Slot& slot = this->Slot(address + object_index);
+      for (int row_index = 0; row_index < height; row_index++) {
+        pool.cells[(row_index * count) + object_index] = slot.cells[row_index * slot.stride];
+      }
+      this->Release(address + object_index);
+      slot.cells = pool.cells + object_index;
+      slot.stride = count;
+      slot.stamp++;
+    }
+    this->pools.push_back(pool);
+  }
+
+  /**
+   * Moves every object out of its pool and frees the pools.
+   */
+  void cMemory::Unmap_Pools() {
+    for (size_t pool_index = 0; pool_index < this->pools.size(); pool_index++) {
+      sPool& pool = this->pools[pool_index];
+      for (int object_index = 0; object_index < pool.count; object_index++) {
+        int object = pool.address + object_index;
+        if (this->Is_Pooled(object)) {
+          this->Resize(object, this->Slot(object).width, this->Slot(object).height);
+        }
+      }
+    }
+    for (size_t pool_index = 0; pool_index < this->pools.size(); pool_index++) {
+      delete[] this->pools[pool_index].cells;
+    }
+    this->pools.clear();
+  }
+
+  /**
+   * Releases the storage of a table that is not in the arena. Images are unmapped once
+   * no table points into them anymore. The slot still has to be given new cells.
+   * @param address The address of the table.
+   */
+  void cMemory::Release(int address) {
+    sTable_Slot& slot = this->Slot(address);
+    if (slot.image) {
+      cImage_File* image = slot.image;
+      slot.image = NULL;
+      if (--image->references == 0) {
+        this->images.erase(std::find(this->images.begin(), this->images.end(), image));
+        delete image;
+      }
+    }
+    else if (this->Is_Spilled(address)) {
+      delete[] slot.cells;
+    }
+  }
+
+  /**
+   * Reads a cell of a table.
+   * @param address The address of the table.
+   * @param row The row of the cell.
+   * @param col The column of the cell.
+   * @return The value of the cell.
+   * @throws An error if the address or cell is invalid.
+   */
+  int cMemory::Read(int address, int row, int col) {
+    sTable_Slot& slot = (*this)[address];
+    if ((row < 0) || (row >= slot.height) || (col < 0) || (col >= slot.width)) {
+      throw cError("Invalid cell " + Number_To_Text(col) + "," + Number_To_Text(row) + " accessed at " + Number_To_Text(address) + ".");
+    }
+    C_LESH_PROFILE_READ(address);
+    return slot.cells[(row * slot.stride) + col];
+  }
+
+  /**
+   * Writes a cell of a table.
+   * @param address The address of the table.
+   * @param row The row of the cell.
+   * @param col The column of the cell.
+   * @param value The value to write.
+   * @throws An error if the address or cell is invalid.
+   */
+  void cMemory::Write(int address, int row, int col, int value) {
+    sTable_Slot& slot = (*this)[address];
+    if ((row < 0) || (row >= slot.height) || (col < 0) || (col >= slot.width)) {
+      throw cError("Invalid cell " + Number_To_Text(col) + "," + Number_To_Text(row) + " accessed at " + Number_To_Text(address) + ".");
+    }
+    slot.cells[(row * slot.stride) + col] = value;
+    slot.stamp++;
+    C_LESH_PROFILE_WRITE(address);
+  }
+
+  /**
+   * Reads the origin cell of a table. Every table has at least one cell.
+   * @param address The address of the table.
+   * @return The value of the origin cell.
+   * @throws An error if the address is invalid.
+   */
+  int cMemory::Read_Scalar(int address) {
+    if ((address < 0) || (address >= this->count)) {
+      C_LESH_FAULT(this, eFAULT_ADDRESS, address, 0, 0, "Invalid address accessed at " + Number_To_Text(address) + ".");
+      return 0;
+    }
+    C_LESH_PROFILE_READ(address);
+    return this->Slot(address).cells[0];
+  }
+
+  /**
+   * Writes the origin cell of a table.
+   * @param address The address of the table.
+   * @param value The value to write.
+   * @throws An error if the address is invalid.
+   */
+  void cMemory::Write_Scalar(int address, int value) {
+    if ((address < 0) || (address >= this->count)) {
+      C_LESH_FAULT(this, eFAULT_ADDRESS, address, 0, 0, "Invalid address accessed at " + Number_To_Text(address) + ".");
+      return;
+    }
+    sTable_Slot& slot = this->Slot(address);
+    slot.cells[0] = value;
+    slot.stamp++;
+    C_LESH_PROFILE_WRITE(address);
+  }
+
+  /**
+   * Reads the first column of a row of a table.
+   * @param address The address of the table.
+   * @param row The row of the cell.
+   * @return The value of the cell.
+   * @throws An error if the address or cell is invalid.
+   */
+  int cMemory::Read_Row(int address, int row) {
+    sCell cell;
+    if (this->Locate(address, row, 0, cell)) {
+      return this->Read_Cell(cell, 0);
+    }
+    return 0;
+  }
+
+  /**
+   * Writes the first column of a row of a table.
+   * @param address The address of the table.
+   * @param row The row of the cell.
+   * @param value The value to write.
+   * @throws An error if the address or cell is invalid.
+   */
+  void cMemory::Write_Row(int address, int row, int value) {
+    sCell cell;
+    if (this->Locate(address, row, 0, cell)) {
+      this->Write_Cell(cell, 0, value);
+    }
+  }
+
+  /**
+   * Resolves a cell of a table to a cell reference. The address and cell are checked
+   * once here so the reference can be read and written without checks or cursors.
+   * @param address The address of the table.
+   * @param row The row of the cell.
+   * @param col The column of the cell.
+   * @param cell The cell reference to fill in.
+   * @return True if the cell was found, false if a fault was raised.
+   * @throws An error if the address or cell is invalid.
+   */
+  bool cMemory::Locate(int address, int row, int col, sCell& cell) {
+    if ((address < 0) || (address >= this->count)) {
+      C_LESH_FAULT(this, eFAULT_ADDRESS, address, row, col, "Invalid address accessed at " + Number_To_Text(address) + ".");
+      return false;
+    }
+    sTable_Slot& slot = this->Slot(address);
+    if ((row < 0) || (row >= slot.height) || (col < 0) || (col >= slot.width)) {
+      C_LESH_FAULT(this, eFAULT_CELL, address, row, col, "Invalid cell " + Number_To_Text(col) + "," + Number_To_Text(row) + " accessed at " + Number_To_Text(address) + ".");
+      return false;
+    }
+    cell.slot = &slot;
+    cell.address = address;
+    cell.offset = (row * slot.stride) + col;
+    return true;
+  }
+
+  /**
+   * Reads through a cell reference. The slot is followed on every read so the
+   * reference survives the table being moved by a resize.
+   * @param cell The cell reference.
+   * @param next The number of cells past the reference to read. The caller checks it.
+   * @return The value of the cell.
+   */
+  int cMemory::Read_Cell(sCell& cell, int next) {
+    C_LESH_PROFILE_READ(cell.address);
+    return cell.slot->cells[cell.offset + next];
+  }
+
+  /**
+   * Writes through a cell reference.
+   * @param cell The cell reference.
+   * @param next The number of cells past the reference to write. The caller checks it.
+   * @param value The value to write.
+   */
+  void cMemory::Write_Cell(sCell& cell, int next, int value) {
+    cell.slot->cells[cell.offset + next] = value;
+    cell.slot->stamp++;
+    C_LESH_PROFILE_WRITE(cell.address);
+  }
+
+  /**
+   * Records a fault. Only the first fault of a run is kept.
+   * @param code The kind of fault.
+   * @param address The address of the table that was accessed.
+   * @param row The row that was accessed.
+   * @param col The column that was accessed.
+   */
+  void cMemory::Raise(int code, int address, int row, int col) {
+    if (this->fault.code == eFAULT_NONE) {
+      this->fault.code = code;
+      this->fault.command = -1;
+      this->fault.opcode = -1;
+      this->fault.operand = -1;
+      this->fault.address = address;
+      this->fault.row = row;
+      this->fault.col = col;
+    }
+  }
+
+  /**
+   * Clears the fault record.
+   */
+  void cMemory::Clear_Fault() {
+    this->fault.code = eFAULT_NONE;
+    this->fault.command = -1;
+    this->fault.opcode = -1;
+    this->fault.operand = -1;
+    this->fault.address = 0;
+    this->fault.row = 0;
+    this->fault.col = 0;
+  }
+
+  /**
+   * Reads the first column of a row without checking. Only for tables and rows that
+   * were proven to exist by the verifier.
+   * @param address The address of the table.
+   * @param row The row of the cell.
+   * @return The value of the cell.
+   */
+  int cMemory::Read_Unchecked(int address, int row) {
+    sTable_Slot& slot = this->Slot(address);
+    C_LESH_PROFILE_READ(address);
+    return slot.cells[row * slot.stride];
+  }
+
+  /**
+   * Writes the first column of a row without checking. Only for tables and rows that
+   * were proven to exist by the verifier.
+   * @param address The address of the table.
+   * @param row The row of the cell.
+   * @param value The value to write.
+   */
+  void cMemory::Write_Unchecked(int address, int row, int value) {
+    sTable_Slot& slot = this->Slot(address);
+    slot.cells[row * slot.stride] = value;
+    slot.stamp++;
+    C_LESH_PROFILE_WRITE(address);
+  }
+
+  /**
+   * Resizes a table keeping the cells that still fit. Tables that leave the default
+   * size get their own storage and tables that return to it move back into the arena.
+   * Objects are moved out of their pool even if the size stays the same.
+   * @param address The address of the table.
+   * @param width The new width.
+   * @param height The new height.
+   * @return True if the table has the new size, false if a fault was raised.
+   * @throws An error if the address or size is invalid.
+   */
+  bool cMemory::Resize(int address, int width, int height) {
+    if (!this->Check_Address(address)) {
+      return false;
+    }
+    sTable_Slot& slot = this->Slot(address);
+    if ((width < 0) || (height < 0)) {
+      C_LESH_FAULT(this, eFAULT_SIZE, address, height, width, "Invalid table size " + Number_To_Text(width) + "x" + Number_To_Text(height) + ".");
+      return false;
+    }
+    if ((width != slot.width) || (height != slot.height) || this->Is_Pooled(address)) {
+      if (this->Is_Stack(address)) {
+        C_LESH_FAULT(this, eFAULT_SIZE, address, height, width, "Stack table " + Number_To_Text(address) + " can not be resized.");
+        return false;
+      }
+      int* home = this->arena + (address * this->table_size);
+      int* cells = home;
+      if ((width == this->table_w) && (height == this->table_h)) {
+        std::fill(home, home + this->table_size, 0);
+      }
+      else {
+        cells = new int[std::max(width * height, 1)]();
+      }
+      int row_count = std::min(height, slot.height);
+      int col_count = std::min(width, slot.width);
+      if (cells != slot.cells) {
+        for (int row_index = 0; row_index < row_count; row_index++) {
+          std::copy(slot.cells + (row_index * slot.stride), slot.cells + (row_index * slot.stride) + col_count, cells + (row_index * width));
+        }
+        this->Release(address);
+      }
+      slot.cells = cells;
+      slot.width = width;
+      slot.height = height;
+      slot.stride = width;
+      slot.stamp++;
+    }
+    return true;
+  }
+
+  /**
+   * Copies a range of tables over another range. Each table takes on the size of its
+   * source. Overlapping ranges are copied in the order that leaves the source intact.
+   * Whole tables are copied in one go when their rows are back to back.
+   * @param destination The address of the first table to copy to.
+   * @param source The address of the first table to copy from.
+   * @param count The number of tables.
+   * @throws An error if either range does not fit in memory.
+   */
+  void cMemory::Copy(int destination, int source, int count) {
+    if ((count < 0) || (destination < 0) || (source < 0) || (destination + count > this->count) || (source + count > this->count)) {
+      C_LESH_FAULT(this, eFAULT_RANGE, ((destination < 0) || (destination + count > this->count)) ? destination : source, 0, count, "Can not copy " + Number_To_Text(count) + " tables from " + Number_To_Text(source) + " to " + Number_To_Text(destination) + ".");
+      return;
+    }
+    if (destination == source) {
+      return;
+    }
+    int step = (destination > source) ? -1 : 1;
+    int table_index = (destination > source) ? count - 1 : 0;
+    for (int copy_index = 0; copy_index < count; copy_index++, table_index += step) {
+      sTable_Slot& from = this->Slot(source + table_index);
+      if ((from.width != this->Slot(destination + table_index).width) || (from.height != this->Slot(destination + table_index).height)) {
+        if (!this->Resize(destination + table_index, from.width, from.height)) {
+          return; // The cells would not fit.
+        }
+      }
+      sTable_Slot& to = this->Slot(destination + table_index);
+      if ((from.stride == from.width) && (to.stride == to.width)) {
+        std::copy(from.cells, from.cells + (from.width * from.height), to.cells);
+      }
+      else {
+        for (int row_index = 0; row_index < from.height; row_index++) {
+          std::copy(from.cells + (row_index * from.stride), from.cells + (row_index * from.stride) + from.width, to.cells + (row_index * to.stride));
+        }
+      }
+      to.stamp++;
+      C_LESH_PROFILE_READ(source + table_index);
+      C_LESH_PROFILE_WRITE(destination + table_index);
+    }
+  }
+
+  /**
+   * Copies a rectangle of cells from one table to another. The rectangle is clipped to
+   * both tables. A table can be copied onto itself.
+   * @param destination The address of the table to copy to.
+   * @param dest_x The column to copy to.
+   * @param dest_y The row to copy to.
+   * @param source The address of the table to copy from.
+   * @param source_x The column to copy from.
+   * @param source_y The row to copy from.
+   * @param width The width of the rectangle.
+   * @param height The height of the rectangle.
+   * @throws An error if either address is invalid.
+   */
+  void cMemory::Copy_Block(int destination, int dest_x, int dest_y, int source, int source_x, int source_y, int width, int height) {
+    if (!this->Check_Address(destination) || !this->Check_Address(source)) {
+      return;
+    }
+    sTable_Slot& to = this->Slot(destination);
+    sTable_Slot& from = this->Slot(source);
+    if (source_x < 0) {
+      dest_x -= source_x;
+      width += source_x;
+      source_x = 0;
+    }
+    if (source_y < 0) {
+      dest_y -= source_y;
+      height += source_y;
+      source_y = 0;
+    }
+    if (dest_x < 0) {
+      source_x -= dest_x;
+      width += dest_x;
+      dest_x = 0;
+    }
+    if (dest_y < 0) {
+      source_y -= dest_y;
+      height += dest_y;
+      dest_y = 0;
+    }
+    width = std::min(width, std::min(from.width - source_x, to.width - dest_x));
+    height = std::min(height, std::min(from.height - source_y, to.height - dest_y));
+    if ((width <= 0) || (height <= 0)) {
+      return;
+    }
+    bool upward = (destination == source) && (dest_y > source_y); // Copy from the bottom so rows are not overwritten first.
+    for (int row_index = 0; row_index < height; row_index++) {
+      int row = upward ? (height - 1 - row_index) : row_index;
+      std::memmove(to.cells + ((dest_y + row) * to.stride) + dest_x, from.cells + ((source_y + row) * from.stride) + source_x, width * sizeof(int));
+    }
+    to.stamp++;
+    C_LESH_PROFILE_READ(source);
+    C_LESH_PROFILE_WRITE(destination);
+  }
+
+  /**
+   * Sets every cell of a range of tables to a value.
+   * @param address The address of the first table.
+   * @param count The number of tables.
+   * @param value The value to set.
+   * @throws An error if the range does not fit in memory.
+   */
+  void cMemory::Fill(int address, int count, int value) {
+    if ((count < 0) || (address < 0) || (address + count > this->count)) {
+      C_LESH_FAULT(this, eFAULT_RANGE, address, 0, count, "Can not fill " + Number_To_Text(count) + " tables at " + Number_To_Text(address) + ".");
+      return;
+    }
+    for (int table_index = address; table_index < address + count; table_index++) {
+      sTable_Slot& slot = this->Slot(table_index);
+      if (slot.stride == slot.width) {
+        std::fill(slot.cells, slot.cells + (slot.width * slot.height), value);
+      }
+      else {
+        for (int row_index = 0; row_index < slot.height; row_index++) {
+          std::fill(slot.cells + (row_index * slot.stride), slot.cells + (row_index * slot.stride) + slot.width, value);
+        }
+      }
+      slot.stamp++;
+      C_LESH_PROFILE_WRITE(table_index);
+    }
+  }
+
+  /**
+   * Copies a table from a picture processor table into memory.
+   * @param address The address of the table.
+   * @param table The table to copy from.
+   * @return True if the table was copied, false if a fault was raised.
+   * @throws An error if the address is invalid.
+   */
+  bool cMemory::Import(int address, cTable& table) {
+    if (!this->Resize(address, table.width, table.height)) {
+      return false;
+    }
+    sTable_Slot& slot = this->Slot(address);
+    table.Rewind();
+    for (int row_index = 0; row_index < slot.height; row_index++) {
+      for (int col_index = 0; col_index < slot.width; col_index++) {
+        slot.cells[(row_index * slot.stride) + col_index] = table.Read_Column();
+      }
+      table.Move_To_Next_Row();
+    }
+    table.Rewind();
+    slot.stamp++;
+    return true;
+  }
+
+  /**
+   * Copies a table in memory out to a table.
+   * @param address The address of the table.
+   * @param table The table to copy to. It is resized to fit.
+   * @throws An error if the address is invalid.
+   */
+  void cMemory::Export(int address, cTable& table) {
+    sTable_Slot& slot = (*this)[address];
+    table.Resize(slot.width, slot.height);
+    table.Rewind();
+    for (int row_index = 0; row_index < slot.height; row_index++) {
+      for (int col_index = 0; col_index < slot.width; col_index++) {
+        table.Write_Column(slot.cells[(row_index * slot.stride) + col_index]);
+      }
+      table.Move_To_Next_Row();
+    }
+    table.Rewind();
+  }
+
+  /**
+   * Gets a table that can be handed to the picture processor. The copy is kept until
+   * the table in memory is written to again.
+   * @param address The address of the table.
+   * @return The picture table.
+   * @throws An error if the address is invalid.
+   */
+  cTable& cMemory::Get_Picture(int address) {
+    sTable_Slot& slot = (*this)[address];
+    std::map<int, sPicture>::iterator picture = this->pictures.find(address);
+    if (picture == this->pictures.end()) {
+      sPicture entry;
+      entry.table = new cTable(slot.width, slot.height);
+      entry.stamp = slot.stamp - 1; // Force a copy.
+      picture = this->pictures.insert(std::make_pair(address, entry)).first;
+    }
+    if (picture->second.stamp != slot.stamp) {
+      this->Export(address, *picture->second.table);
+      picture->second.stamp = slot.stamp;
+    }
+    return *picture->second.table;
+  }
+
+  /**
+   * Maps a binary image into memory. The tables point straight into the mapping, which
+   * is private so writes to them never reach the file.
+   * @param name The name of the image file.
+   * @param address The address to load the tables to.
+   * @return The number of tables loaded.
+   * @throws An error if the image is invalid or does not fit.
+   */
+  int cMemory::Load_Image(std::string name, int address) {
+    cImage_File* image = new cImage_File(name);
+    int count = 0;
+    try {
+      if (image->size < sizeof(sImage_Header)) {
+        throw cError("Image " + name + " is too small.");
+      }
+      sImage_Header* header = (sImage_Header*)image->data;
+      if (header->magic != eIMAGE_MAGIC) {
+        throw cError("Image " + name + " is not a C-Lesh image.");
+      }
+      if (header->version != eIMAGE_VERSION) {
+        throw cError("Image " + name + " has unsupported version " + Number_To_Text(header->version) + ".");
+      }
+      count = header->count;
+      if ((count < 0) || ((size_t)count > (image->size - sizeof(sImage_Header)) / sizeof(sImage_Entry))) {
+        throw cError("Image " + name + " has an invalid table count.");
+      }
+      if ((address < 0) || (address + count > this->count)) {
+        throw cError("Image " + name + " does not fit at address " + Number_To_Text(address) + ".");
+      }
+      if ((address < this->stack_address + this->stack_count) && (address + count > this->stack_address)) {
+        throw cError("Image " + name + " overlaps the stack.");
+      }
+      sImage_Entry* entries = (sImage_Entry*)(image->data + sizeof(sImage_Header));
+      for (int table_index = 0; table_index < count; table_index++) {
+        sImage_Entry& entry = entries[table_index];
+        if ((entry.width < 0) || (entry.height < 0) || (entry.offset < 0) || ((entry.offset % sizeof(int32_t)) != 0) ||
+          ((size_t)entry.offset + ((size_t)entry.width * entry.height * sizeof(int32_t)) > image->size)) {
+          throw cError("Image " + name + " has an invalid table at " + Number_To_Text(table_index) + ".");
+        }
+      }
+      for (int table_index = 0; table_index < count; table_index++) {
+        sImage_Entry& entry = entries[table_index];
+        int table_address = address + table_index;
+        if ((entry.width * entry.height) == 0) { // Empty tables still need a cell of their own.
+          this->Resize(table_address, entry.width, entry.height);
+        }
+        else {
+          sTable_Slot& slot = this->Slot(table_address);
+          this->Release(table_address);
+          slot.cells = (int*)(image->data + entry.offset);
+          slot.width = entry.width;
+          slot.height = entry.height;
+          slot.stride = entry.width;
+          slot.image = image;
+          slot.stamp++;
+          image->references++;
+        }
+      }
+    }
+    catch (cError error) {
+      if (image->references == 0) {
+        delete image;
+      }
+      throw error;
+    }
+    if (image->references > 0) {
+      this->images.push_back(image);
+    }
+    else {
+      delete image;
+    }
+    return count;
+  }
+
+  // **************************************************************************
+  // Image File Implementation
+  // **************************************************************************
+
+  /**
+   * Maps an image file into memory. The mapping is copy on write.
+   * @param name The name of the image file.
+   * @throws An error if the file could not be mapped.
+   */
+  cImage_File::cImage_File(std::string name) {
+    this->data = NULL;
+    this->size = 0;
+    this->references = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+      throw cError("Could not open image " + name + ".");
+    }
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    this->size = (size_t)file_size.QuadPart;
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file); // The mapping keeps the file open.
+    if (mapping == NULL) {
+      throw cError("Could not map image " + name + ".");
+    }
+    this->data = (char*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping); // The view keeps the mapping open.
+    if (this->data == NULL) {
+      throw cError("Could not map image " + name + ".");
+    }
+#else
+    int file = open(name.c_str(), O_RDONLY);
+    if (file < 0) {
+      throw cError("Could not open image " + name + ".");
+    }
+    struct stat info;
+    if ((fstat(file, &info) != 0) || (info.st_size == 0)) {
+      close(file);
+      throw cError("Could not map image " + name + ".");
+    }
+    this->size = (size_t)info.st_size;
+    void* data = mmap(NULL, this->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    close(file); // The mapping keeps the file open.
+    if (data == MAP_FAILED) {
+      throw cError("Could not map image " + name + ".");
+    }
+    this->data = (char*)data;
+#endif
+  }
+
+  /**
+   * Unmaps the image file.
+   */
+  cImage_File::~cImage_File() {
+#ifdef _WIN32
+    UnmapViewOfFile(this->data);
+#else
+    munmap(this->data, this->size);
+#endif
+  }
+
+#ifdef C_LESH_JIT
+  // **************************************************************************
+  // Code Buffer Implementation
+  // **************************************************************************
+
+  /**
+   * Allocates memory that machine code can be written to and run from. The memory
+   * is never writable and executable at the same time. It starts out executable.
+   * @param size The size of the buffer in bytes.
+   * @throws An error if the memory could not be allocated.
+   */
+  cCode_Buffer::cCode_Buffer(int size) {
+    this->size = size;
+    this->used = 0;
+#ifdef _WIN32
+    this->code = (unsigned char*)VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READ);
+    if (this->code == NULL) {
+      throw cError("Could not allocate code buffer.");
+    }
+#else
+    void* code = mmap(NULL, size, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+      throw cError("Could not allocate code buffer.");
+    }
+    this->code = (unsigned char*)code;
+#endif
+  }
+
+  /**
+   * Frees the code buffer.
+   */
+  cCode_Buffer::~cCode_Buffer() {
+#ifdef _WIN32
+    VirtualFree(this->code, 0, MEM_RELEASE);
+#else
+    munmap(this->code, this->size);
+#endif
+  }
+
+  /**
+   * Makes the buffer writable so code can be emitted or patched. It can not be run
+   * until it is made executable again.
+   * @throws An error if the protection could not be changed.
+   */
+  void cCode_Buffer::Make_Writable() {
+#ifdef _WIN32
+    DWORD old_protect = 0;
+    if (!VirtualProtect(this->code, this->size, PAGE_READWRITE, &old_protect)) {
+      throw cError("Could not unprotect code buffer.");
+    }
+#else
+    if (mprotect(this->code, this->size, PROT_READ | PROT_WRITE) != 0) {
+      throw cError("Could not unprotect code buffer.");
+    }
+#endif
+  }
+
+  /**
+   * Makes the buffer executable and read only once code has been emitted.
+   * @throws An error if the protection could not be changed.
+   */
+  void cCode_Buffer::Make_Executable() {
+#ifdef _WIN32
+    DWORD old_protect = 0;
+    if (!VirtualProtect(this->code, this->size, PAGE_EXECUTE_READ, &old_protect)) {
+      throw cError("Could not protect code buffer.");
+    }
+    FlushInstructionCache(GetCurrentProcess(), this->code, this->size);
+#else
+    if (mprotect(this->code, this->size, PROT_READ | PROT_EXEC) != 0) {
+      throw cError("Could not protect code buffer.");
+    }
+#endif
+  }
+
+  /**
+   * Emits a byte. Bytes past the end are counted but not written.
+   * @param byte The byte to emit.
+   */
+  void cCode_Buffer::Emit(int byte) {
+    if (this->used < this->size) {
+      this->code[this->used] = (unsigned char)byte;
+    }
+    this->used++;
+  }
+
+  /**
+   * Emits a 32-bit little endian value.
+   * @param value The value to emit.
+   */
+  void cCode_Buffer::Emit_32(int value) {
+    for (int byte_index = 0; byte_index < 4; byte_index++) {
+      this->Emit((int)(((unsigned int)value >> (byte_index * 8)) & 0xFF));
+    }
+  }
+
+  /**
+   * Emits a 64-bit address.
+   * @param address The address to emit.
+   */
+  void cCode_Buffer::Emit_64(const void* address) {
+    uint64_t value = (uint64_t)(uintptr_t)address;
+    for (int byte_index = 0; byte_index < 8; byte_index++) {
+      this->Emit((int)((value >> (byte_index * 8)) & 0xFF));
+    }
+  }
+
+  /**
+   * Emits a jump with a 32-bit offset that is patched later.
+   * @param opcode The second byte of a conditional jump opcode or 0xE9 for a plain jump.
+   * @return The position of the offset.
+   */
+  int cCode_Buffer::Emit_Jump(int opcode) {
+    if (opcode != 0xE9) {
+      this->Emit(0x0F);
+    }
+    this->Emit(opcode);
+    int position = this->used;
+    this->Emit_32(0);
+    return position;
+  }
+
+  /**
+   * Points a jump at the current position.
+   * @param position The position of the offset of the jump.
+   */
+  void cCode_Buffer::Patch(int position) {
+    int offset = this->used - (position + 4);
+    if (position + 4 <= this->size) {
+      for (int byte_index = 0; byte_index < 4; byte_index++) {
+        this->code[position + byte_index] = (unsigned char)(((unsigned int)offset >> (byte_index * 8)) & 0xFF);
+      }
+    }
+  }
+#endif
+
+  // **************************************************************************
+  // Damage Implementation
+  // **************************************************************************
+
+  /**
+   * Creates a damage tracker for a screen of unknown size.
+   */
+  cDamage::cDamage() {
+    this->screen_w = 0;
+    this->screen_h = 0;
+    this->full = true;
+  }
+
+  /**
+   * Sets the size of the screen. The whole screen is damaged so it is presented once.
+   * @param width The width of the screen in pixels.
+   * @param height The height of the screen in pixels.
+   */
+  void cDamage::Set_Screen(int width, int height) {
+    this->screen_w = width;
+    this->screen_h = height;
+    this->Add_Screen();
+  }
+
+  /**
+   * Adds a damaged rectangle. It is clipped to the screen and merged with every region
+   * it overlaps or touches. Once there are too many regions they are merged into one.
+   * @param x The x coordinate of the rectangle.
+   * @param y The y coordinate of the rectangle.
+   * @param width The width of the rectangle.
+   * @param height The height of the rectangle.
+   */
+  void cDamage::Add(int x, int y, int width, int height) {
+    if (this->full) {
+      return;
+    }
+    int left = std::max(x, 0);
+    int top = std::max(y, 0);
+    int right = std::min(x + width, this->screen_w);
+    int bottom = std::min(y + height, this->screen_h);
+    if ((right <= left) || (bottom <= top)) {
+      return;
+    }
+    size_t region_index = 0;
+    while (region_index < this->regions.size()) {
+      sRegion& region = this->regions[region_index];
+      if ((left <= region.x + region.width) && (region.x <= right) && (top <= region.y + region.height) && (region.y <= bottom)) {
+        left = std::min(left, region.x);
+        top = std::min(top, region.y);
+        right = std::max(right, region.x + region.width);
+        bottom = std::max(bottom, region.y + region.height);
+        this->regions.erase(this->regions.begin() + region_index);
+        region_index = 0; // The bigger rectangle may touch regions that were checked.
+      }
+      else {
+        region_index++;
+      }
+    }
+    if (this->regions.size() >= C_LESH_DAMAGE_REGIONS) {
+      for (region_index = 0; region_index < this->regions.size(); region_index++) {
+        sRegion& region = this->regions[region_index];
+        left = std::min(left, region.x);
+        top = std::min(top, region.y);
+        right = std::max(right, region.x + region.width);
+        bottom = std::max(bottom, region.y + region.height);
+      }
+      this->regions.clear();
+    }
+    if ((left == 0) && (top == 0) && (right == this->screen_w) && (bottom == this->screen_h)) {
+      this->Add_Screen();
+      return;
+    }
+    sRegion region;
+    region.x = left;
+    region.y = top;
+    region.width = right - left;
+    region.height = bottom - top;
+    this->regions.push_back(region);
+  }
+
+  /**
+   * Damages the whole screen.
+   */
+  void cDamage::Add_Screen() {
+    this->full = true;
+    this->regions.clear();
+  }
+
+  /**
+   * Forgets the damage after the screen was presented.
+   */
+  void cDamage::Reset() {
+    this->full = false;
+    this->regions.clear();
+  }
+
+  /**
+   * Gets the number of damaged pixels.
+   * @return The area of the damage.
+   */
+  long long cDamage::Area() {
+    if (this->full) {
+      return (long long)this->screen_w * this->screen_h;
+    }
+    long long area = 0;
+    for (size_t region_index = 0; region_index < this->regions.size(); region_index++) {
+      area += (long long)this->regions[region_index].width * this->regions[region_index].height;
+    }
+    return area;
+  }
+
+  /**
+   * Gets the regions to present. A damaged screen is one region.
+   * @return The damaged regions.
+   */
+  std::vector<sRegion>& cDamage::Get_Regions() {
+    if (this->full && this->regions.empty()) {
+      sRegion region;
+      region.x = 0;
+      region.y = 0;
+      region.width = this->screen_w;
+      region.height = this->screen_h;
+      this->regions.push_back(region);
+    }
+    return this->regions;
+  }
+
+  /**
+   * Adds the damage of another tracker.
+   * @param damage The other damage.
+   */
+  void cDamage::Merge(cDamage& damage) {
+    if (damage.full) {
+      this->Add_Screen();
+    }
+    else {
+      for (size_t region_index = 0; region_index < damage.regions.size(); region_index++) {
+        sRegion& region = damage.regions[region_index];
+        this->Add(region.x, region.y, region.width, region.height);
+      }
+    }
+  }
+
+  // **************************************************************************
+  // Frame Buffer Implementation
+  // **************************************************************************
+
+  // Span kernels copy one clipped row of picture cells to the frame. Flipped kernels
+  // read the cells from right to left starting at the cell given.
+
+  static void Fill_Scalar(uint32_t* pixels, int count, uint32_t color) {
+    std::fill(pixels, pixels + count, color);
+  }
+
+  static void Copy_Span_Scalar(uint32_t* pixels, const int* cells, int count) {
+    for (int pixel_index = 0; pixel_index < count; pixel_index++) {
+      pixels[pixel_index] = (uint32_t)cells[pixel_index];
+    }
+  }
+
+  static void Key_Span_Scalar(uint32_t* pixels, const int* cells, int count) {
+    for (int pixel_index = 0; pixel_index < count; pixel_index++) {
+      if (cells[pixel_index] >= 0) {
+        pixels[pixel_index] = (uint32_t)cells[pixel_index];
+      }
+    }
+  }
+
+  static void Flip_Span_Scalar(uint32_t* pixels, const int* cells, int count) {
+    for (int pixel_index = 0; pixel_index < count; pixel_index++) {
+      pixels[pixel_index] = (uint32_t)cells[-pixel_index];
+    }
+  }
+
+  static void Flip_Key_Span_Scalar(uint32_t* pixels, const int* cells, int count) {
+    for (int pixel_index = 0; pixel_index < count; pixel_index++) {
+      if (cells[-pixel_index] >= 0) {
+        pixels[pixel_index] = (uint32_t)cells[-pixel_index];
+      }
+    }
+  }
+
+  // Index kernels keep the low byte of each cell as a palette index.
+
+  static void Copy_Index_Scalar(uint8_t* indices, const int* cells, int count) {
+    for (int pixel_index = 0; pixel_index < count; pixel_index++) {
+      indices[pixel_index] = (uint8_t)cells[pixel_index];
+    }
+  }
+
+  static void Key_Index_Scalar(uint8_t* indices, const int* cells, int count) {
+    for (int pixel_index = 0; pixel_index < count; pixel_index++) {
+      if (cells[pixel_index] >= 0) {
+        indices[pixel_index] = (uint8_t)cells[pixel_index];
+      }
+    }
+  }
+
+  static void Flip_Index_Scalar(uint8_t* indices, const int* cells, int count) {
+    for (int pixel_index = 0; pixel_index < count; pixel_index++) {
+      indices[pixel_index] = (uint8_t)cells[-pixel_index];
+    }
+  }
+
+  static void Flip_Key_Index_Scalar(uint8_t* indices, const int* cells, int count) {
+    for (int pixel_index = 0; pixel_index < count; pixel_index++) {
+      if (cells[-pixel_index] >= 0) {
+        indices[pixel_index] = (uint8_t)cells[-pixel_index];
+      }
+    }
+  }
+
+  static void Expand_Scalar(uint32_t* pixels, const uint8_t* indices, const uint32_t* palette, int count) {
+    for (int pixel_index = 0; pixel_index < count; pixel_index++) {
+      pixels[pixel_index] = palette[indices[pixel_index]];
+    }
+  }
+
+#ifdef C_LESH_BLIT_SSE2
+  static void Fill_SSE2(uint32_t* pixels, int count, uint32_t color) {
+    __m128i colors = _mm_set1_epi32((int)color);
+    int pixel_index = 0;
+    for (; pixel_index + 4 <= count; pixel_index += 4) {
+      _mm_storeu_si128((__m128i*)(pixels + pixel_index), colors);
+    }
+    Fill_Scalar(pixels + pixel_index, count - pixel_index, color);
+  }
+
+  static void Copy_Span_SSE2(uint32_t* pixels, const int* cells, int count) {
+    int pixel_index = 0;
+    for (; pixel_index + 4 <= count; pixel_index += 4) {
+      _mm_storeu_si128((__m128i*)(pixels + pixel_index), _mm_loadu_si128((const __m128i*)(cells + pixel_index)));
+    }
+    Copy_Span_Scalar(pixels + pixel_index, cells + pixel_index, count - pixel_index);
+  }
+
+  static void Key_Span_SSE2(uint32_t* pixels, const int* cells, int count) {
+    int pixel_index = 0;
+    for (; pixel_index + 4 <= count; pixel_index += 4) {
+      __m128i source = _mm_loadu_si128((const __m128i*)(cells + pixel_index));
+      __m128i dest = _mm_loadu_si128((const __m128i*)(pixels + pixel_index));
+      __m128i holes = _mm_srai_epi32(source, 31); // All ones where the cell is negative.
+      __m128i result = _mm_or_si128(_mm_and_si128(holes, dest), _mm_andnot_si128(holes, source));
+      _mm_storeu_si128((__m128i*)(pixels + pixel_index), result);
+    }
+    Key_Span_Scalar(pixels + pixel_index, cells + pixel_index, count - pixel_index);
+  }
+
+  static void Flip_Span_SSE2(uint32_t* pixels, const int* cells, int count) {
+    int pixel_index = 0;
+    for (; pixel_index + 4 <= count; pixel_index += 4) {
+      __m128i source = _mm_loadu_si128((const __m128i*)(cells - pixel_index - 3));
+      _mm_storeu_si128((__m128i*)(pixels + pixel_index), _mm_shuffle_epi32(source, _MM_SHUFFLE(0, 1, 2, 3)));
+    }
+    Flip_Span_Scalar(pixels + pixel_index, cells - pixel_index, count - pixel_index);
+  }
+
+  static void Flip_Key_Span_SSE2(uint32_t* pixels, const int* cells, int count) {
+    int pixel_index = 0;
+    for (; pixel_index + 4 <= count; pixel_index += 4) {
+      __m128i source = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(cells - pixel_index - 3)), _MM_SHUFFLE(0, 1, 2, 3));
+      __m128i dest = _mm_loadu_si128((const __m128i*)(pixels + pixel_index));
+      __m128i holes = _mm_srai_epi32(source, 31);
+      __m128i result = _mm_or_si128(_mm_and_si128(holes, dest), _mm_andnot_si128(holes, source));
+      _mm_storeu_si128((__m128i*)(pixels + pixel_index), result);
+    }
+    Flip_Key_Span_Scalar(pixels + pixel_index, cells - pixel_index, count - pixel_index);
+  }
+
+  // Index kernels pack 16 cells into 16 indices at a time. The quads of cells are read
+  // forward or backward for flipped pictures.
+  #define C_LESH_QUAD(quad_index) \
+    _mm_loadu_si128((const __m128i*)(cells + pixel_index + ((quad_index) * 4)))
+  #define C_LESH_FLIPPED_QUAD(quad_index) \
+    _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(cells - pixel_index - ((quad_index) * 4) - 3)), _MM_SHUFFLE(0, 1, 2, 3))
+  #define C_LESH_INDEX_LOOP(quad, key) \
+    __m128i low = _mm_set1_epi32(0xFF); \
+    int pixel_index = 0; \
+    for (; pixel_index + 16 <= count; pixel_index += 16) { \
+      __m128i quad_0 = quad(0); \
+      __m128i quad_1 = quad(1); \
+      __m128i quad_2 = quad(2); \
+      __m128i quad_3 = quad(3); \
+      __m128i source = _mm_packus_epi16(_mm_packs_epi32(_mm_and_si128(quad_0, low), _mm_and_si128(quad_1, low)), \
+        _mm_packs_epi32(_mm_and_si128(quad_2, low), _mm_and_si128(quad_3, low))); \
+      if (key) { \
+        __m128i holes = _mm_packs_epi16(_mm_packs_epi32(_mm_srai_epi32(quad_0, 31), _mm_srai_epi32(quad_1, 31)), \
+          _mm_packs_epi32(_mm_srai_epi32(quad_2, 31), _mm_srai_epi32(quad_3, 31))); \
+        __m128i dest = _mm_loadu_si128((const __m128i*)(indices + pixel_index)); \
+        source = _mm_or_si128(_mm_and_si128(holes, dest), _mm_andnot_si128(holes, source)); \
+      } \
+      _mm_storeu_si128((__m128i*)(indices + pixel_index), source); \
+    }
+
+  static void Copy_Index_SSE2(uint8_t* indices, const int* cells, int count) {
+    C_LESH_INDEX_LOOP(C_LESH_QUAD, false);
+    Copy_Index_Scalar(indices + pixel_index, cells + pixel_index, count - pixel_index);
+  }
+
+  static void Key_Index_SSE2(uint8_t* indices, const int* cells, int count) {
+    C_LESH_INDEX_LOOP(C_LESH_QUAD, true);
+    Key_Index_Scalar(indices + pixel_index, cells + pixel_index, count - pixel_index);
+  }
+
+  static void Flip_Index_SSE2(uint8_t* indices, const int* cells, int count) {
+    C_LESH_INDEX_LOOP(C_LESH_FLIPPED_QUAD, false);
+    Flip_Index_Scalar(indices + pixel_index, cells - pixel_index, count - pixel_index);
+  }
+
+  static void Flip_Key_Index_SSE2(uint8_t* indices, const int* cells, int count) {
+    C_LESH_INDEX_LOOP(C_LESH_FLIPPED_QUAD, true);
+    Flip_Key_Index_Scalar(indices + pixel_index, cells - pixel_index, count - pixel_index);
+  }
+
+  #undef C_LESH_INDEX_LOOP
+  #undef C_LESH_FLIPPED_QUAD
+  #undef C_LESH_QUAD
+#endif
+
+#ifdef C_LESH_BLIT_AVX2
+  // Built for AVX2 without compiling the rest of the program for it. Only used when the
+  // processor reports AVX2.
+
+  __attribute__((target("avx2"))) static void Fill_AVX2(uint32_t* pixels, int count, uint32_t color) {
+    __m256i colors = _mm256_set1_epi32((int)color);
+    int pixel_index = 0;
+    for (; pixel_index + 8 <= count; pixel_index += 8) {
+      _mm256_storeu_si256((__m256i*)(pixels + pixel_index), colors);
+    }
+    Fill_Scalar(pixels + pixel_index, count - pixel_index, color);
+  }
+
+  __attribute__((target("avx2"))) static void Copy_Span_AVX2(uint32_t* pixels, const int* cells, int count) {
+    int pixel_index = 0;
+    for (; pixel_index + 8 <= count; pixel_index += 8) {
+      _mm256_storeu_si256((__m256i*)(pixels + pixel_index), _mm256_loadu_si256((const __m256i*)(cells + pixel_index)));
+    }
+    Copy_Span_Scalar(pixels + pixel_index, cells + pixel_index, count - pixel_index);
+  }
+
+  __attribute__((target("avx2"))) static void Key_Span_AVX2(uint32_t* pixels, const int* cells, int count) {
+    int pixel_index = 0;
+    for (; pixel_index + 8 <= count; pixel_index += 8) {
+      __m256i source = _mm256_loadu_si256((const __m256i*)(cells + pixel_index));
+      __m256i dest = _mm256_loadu_si256((const __m256i*)(pixels + pixel_index));
+      _mm256_storeu_si256((__m256i*)(pixels + pixel_index), _mm256_blendv_epi8(source, dest, _mm256_srai_epi32(source, 31)));
+    }
+    Key_Span_Scalar(pixels + pixel_index, cells + pixel_index, count - pixel_index);
+  }
+
+  __attribute__((target("avx2"))) static void Flip_Span_AVX2(uint32_t* pixels, const int* cells, int count) {
+    __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    int pixel_index = 0;
+    for (; pixel_index + 8 <= count; pixel_index += 8) {
+      __m256i source = _mm256_loadu_si256((const __m256i*)(cells - pixel_index - 7));
+      _mm256_storeu_si256((__m256i*)(pixels + pixel_index), _mm256_permutevar8x32_epi32(source, reverse));
+    }
+    Flip_Span_Scalar(pixels + pixel_index, cells - pixel_index, count - pixel_index);
+  }
+
+  __attribute__((target("avx2"))) static void Flip_Key_Span_AVX2(uint32_t* pixels, const int* cells, int count) {
+    __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    int pixel_index = 0;
+    for (; pixel_index + 8 <= count; pixel_index += 8) {
+      __m256i source = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)(cells - pixel_index - 7)), reverse);
+      __m256i dest = _mm256_loadu_si256((const __m256i*)(pixels + pixel_index));
+      _mm256_storeu_si256((__m256i*)(pixels + pixel_index), _mm256_blendv_epi8(source, dest, _mm256_srai_epi32(source, 31)));
+    }
+    Flip_Key_Span_Scalar(pixels + pixel_index, cells - pixel_index, count - pixel_index);
+  }
+
+  __attribute__((target("avx2"))) static void Expand_AVX2(uint32_t* pixels, const uint8_t* indices, const uint32_t* palette, int count) {
+    int pixel_index = 0;
+    for (; pixel_index + 8 <= count; pixel_index += 8) {
+      __m256i colors = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(indices + pixel_index)));
+      _mm256_storeu_si256((__m256i*)(pixels + pixel_index), _mm256_i32gather_epi32((const int*)palette, colors, 4));
+    }
+    Expand_Scalar(pixels + pixel_index, indices + pixel_index, palette, count - pixel_index);
+  }
+#endif
+
+  // Ordered from slowest to fastest.
+  static const sBlitter BLITTERS[] = {
+    { "scalar", Fill_Scalar, { Copy_Span_Scalar, Key_Span_Scalar, Flip_Span_Scalar, Flip_Key_Span_Scalar },
+      { Copy_Index_Scalar, Key_Index_Scalar, Flip_Index_Scalar, Flip_Key_Index_Scalar }, Expand_Scalar },
+#ifdef C_LESH_BLIT_SSE2
+    { "sse2", Fill_SSE2, { Copy_Span_SSE2, Key_Span_SSE2, Flip_Span_SSE2, Flip_Key_Span_SSE2 },
+      { Copy_Index_SSE2, Key_Index_SSE2, Flip_Index_SSE2, Flip_Key_Index_SSE2 }, Expand_Scalar },
+#endif
+#ifdef C_LESH_BLIT_AVX2
+    { "avx2", Fill_AVX2, { Copy_Span_AVX2, Key_Span_AVX2, Flip_Span_AVX2, Flip_Key_Span_AVX2 },
+      { Copy_Index_SSE2, Key_Index_SSE2, Flip_Index_SSE2, Flip_Key_Index_SSE2 }, Expand_AVX2 },
+#endif
+  };
+
+  static const char* DRAW_MODE_NAMES[] = {
+    "opaque", "transparent", "flip", "flip transparent"
+  };
+
+  /**
+   * Creates an empty frame buffer with the fastest blitter the processor can run. The
+   * palette starts out with 3 bits of red, 3 bits of green and 2 bits of blue.
+   */
+  cFrame_Buffer::cFrame_Buffer() {
+    this->width = 0;
+    this->height = 0;
+    this->indexed = false;
+    this->blitter = Select_Blitter();
+    for (int color_index = 0; color_index < C_LESH_PALETTE_SIZE; color_index++) {
+      int red = ((color_index >> 5) & 7) * 255 / 7;
+      int green = ((color_index >> 2) & 7) * 255 / 7;
+      int blue = (color_index & 3) * 255 / 3;
+      this->palette[color_index] = (uint32_t)((red << 16) | (green << 8) | blue);
+    }
+  }
+
+  /**
+   * Resizes the frame. The pixels are cleared to black and the indices to 0.
+   * @param width The width of the frame in pixels.
+   * @param height The height of the frame in pixels.
+   */
+  void cFrame_Buffer::Resize(int width, int height) {
+    this->width = std::max(width, 0);
+    this->height = std::max(height, 0);
+    this->pixels.assign((size_t)this->width * this->height, 0);
+    this->indices.assign(this->indexed ? this->pixels.size() : 0, 0);
+  }
+
+  /**
+   * Clears the frame to one color. An indexed frame is cleared to the closest color in
+   * the palette.
+   * @param color The color as 0xRRGGBB.
+   */
+  void cFrame_Buffer::Clear(uint32_t color) {
+    if (this->indexed) {
+      if (!this->indices.empty()) {
+        std::memset(&this->indices[0], this->Find_Color(color), this->indices.size());
+      }
+    }
+    else if (!this->pixels.empty()) {
+      this->blitter->fill(&this->pixels[0], (int)this->pixels.size(), color);
+    }
+  }
+
+  /**
+   * Draws a picture on the frame. The picture is clipped once and then copied a row at
+   * a time.
+   * @param cells The cells of the picture.
+   * @param width The width of the picture.
+   * @param height The height of the picture.
+   * @param stride The number of cells between rows of the picture.
+   * @param x The x coordinate of the picture.
+   * @param y The y coordinate of the picture.
+   * @param mode The draw mode.
+   * @throws An error if the draw mode is invalid.
+   */
+  void cFrame_Buffer::Blit(const int* cells, int width, int height, int stride, int x, int y, int mode) {
+    if ((mode < eDRAW_OPAQUE) || (mode > eDRAW_FLIP_TRANSPARENT)) {
+      throw cError("Invalid draw mode " + Number_To_Text(mode) + ".");
+    }
+    int left = std::max(x, 0);
+    int top = std::max(y, 0);
+    int right = std::min(x + width, this->width);
+    int bottom = std::min(y + height, this->height);
+    if ((right <= left) || (bottom <= top)) {
+      return;
+    }
+    int col = (mode & eDRAW_FLIP) ? (x + width - 1 - left) : (left - x);
+    const int* source = cells + ((top - y) * stride) + col;
+    size_t offset = ((size_t)top * this->width) + left;
+    if (this->indexed) {
+      tIndex_Kernel kernel = this->blitter->index_spans[mode];
+      uint8_t* dest = &this->indices[offset];
+      for (int row = top; row < bottom; row++) {
+        kernel(dest, source, right - left);
+        source += stride;
+        dest += this->width;
+      }
+    }
+    else {
+      tSpan_Kernel kernel = this->blitter->spans[mode];
+      uint32_t* dest = &this->pixels[offset];
+      for (int row = top; row < bottom; row++) {
+        kernel(dest, source, right - left);
+        source += stride;
+        dest += this->width;
+      }
+    }
+  }
+
+  /**
+   * Copies regions of another frame of the same size.
+   * @param source The frame to copy from.
+   * @param regions The regions to copy.
+   */
+  void cFrame_Buffer::Copy_Regions(cFrame_Buffer& source, std::vector<sRegion>& regions) {
+    for (size_t region_index = 0; region_index < regions.size(); region_index++) {
+      sRegion& region = regions[region_index];
+      for (int row = region.y; row < region.y + region.height; row++) {
+        size_t offset = ((size_t)row * this->width) + region.x;
+        std::memcpy(&this->pixels[offset], &source.pixels[offset], region.width * sizeof(uint32_t));
+      }
+    }
+  }
+
+  /**
+   * Looks up the colors of regions of an indexed frame and writes them to the pixels.
+   * @param regions The regions to expand.
+   */
+  void cFrame_Buffer::Expand(std::vector<sRegion>& regions) {
+    for (size_t region_index = 0; region_index < regions.size(); region_index++) {
+      sRegion& region = regions[region_index];
+      for (int row = region.y; row < region.y + region.height; row++) {
+        size_t offset = ((size_t)row * this->width) + region.x;
+        this->blitter->expand(&this->pixels[offset], &this->indices[offset], this->palette, region.width);
+      }
+    }
+  }
+
+  /**
+   * Loads a palette. Each line has the red, green and blue of one color separated by
+   * commas. Colors that are not in the file are left alone.
+   * @param name The name of the palette file.
+   * @throws An error if the palette could not be loaded.
+   */
+  void cFrame_Buffer::Load_Palette(std::string name) {
+    std::ifstream palette_file(name.c_str());
+    if (!palette_file) {
+      throw cError("Could not load palette " + name + ".");
+    }
+    int color_index = 0;
+    while (palette_file && (color_index < C_LESH_PALETTE_SIZE)) {
+      std::string line;
+      std::getline(palette_file, line);
+      cArray<std::string> color = Parse_Sausage_Text(line, ",");
+      if (color.Count() == 3) {
+        this->palette[color_index++] = (uint32_t)(((Text_To_Number(color[0]) & 0xFF) << 16) |
+          ((Text_To_Number(color[1]) & 0xFF) << 8) | (Text_To_Number(color[2]) & 0xFF));
+      }
+    }
+  }
+
+  /**
+   * Finds the color in the palette that is closest to a color.
+   * @param color The color as 0xRRGGBB.
+   * @return The index of the closest color.
+   */
+  int cFrame_Buffer::Find_Color(uint32_t color) {
+    int closest = 0;
+    int closest_distance = 0x7FFFFFFF;
+    for (int color_index = 0; color_index < C_LESH_PALETTE_SIZE; color_index++) {
+      int red = (int)((color >> 16) & 0xFF) - (int)((this->palette[color_index] >> 16) & 0xFF);
+      int green = (int)((color >> 8) & 0xFF) - (int)((this->palette[color_index] >> 8) & 0xFF);
+      int blue = (int)(color & 0xFF) - (int)(this->palette[color_index] & 0xFF);
+      int distance = (red * red) + (green * green) + (blue * blue);
+      if (distance < closest_distance) {
+        closest = color_index;
+        closest_distance = distance;
+      }
+    }
+    return closest;
+  }
+
+  /**
+   * Gets the number of blitters built into the program.
+   * @return The number of blitters.
+   */
+  int cFrame_Buffer::Count_Blitters() {
+    return (int)(sizeof(BLITTERS) / sizeof(sBlitter));
+  }
+
+  /**
+   * Gets a blitter if the processor can run it.
+   * @param index The index of the blitter.
+   * @return The blitter or NULL if the processor lacks its instructions.
+   */
+  const sBlitter* cFrame_Buffer::Get_Blitter(int index) {
+    const sBlitter* blitter = &BLITTERS[index];
+#ifdef C_LESH_BLIT_AVX2
+    if ((blitter->fill == Fill_AVX2) && !__builtin_cpu_supports("avx2")) {
+      blitter = NULL;
+    }
+#endif
+    return blitter;
+  }
+
+  /**
+   * Picks the fastest blitter the processor can run.
+   * @return The blitter.
+   */
+  const sBlitter* cFrame_Buffer::Select_Blitter() {
+    for (int blitter_index = Count_Blitters() - 1; blitter_index > 0; blitter_index--) {
+      const sBlitter* blitter = Get_Blitter(blitter_index);
+      if (blitter) {
+        return blitter;
+      }
+    }
+    return &BLITTERS[0];
+  }
+
+  /**
+   * Clears a frame and draws 32x32 pictures on it with every blitter and draw mode, in
+   * full color and indexed, and prints the pixels per second of each. The time to expand
+   * an indexed frame is printed too. A quarter of the picture cells are transparent.
+   * @param width The width of the frame.
+   * @param height The height of the frame.
+   * @throws An error if the frame is smaller than a picture.
+   */
+  void cFrame_Buffer::Benchmark(int width, int height) {
+    const int size = 32;
+    const int rounds = 100;
+    if ((width < size) || (height < size)) {
+      throw cError("Frame must be at least " + Number_To_Text(size) + "x" + Number_To_Text(size) + ".");
+    }
+    std::vector<int> cells(size * size);
+    for (int cell_index = 0; cell_index < size * size; cell_index++) {
+      cells[cell_index] = ((cell_index * 7) % 4 == 0) ? -1 : (cell_index * 0x010203) & 0xFFFFFF;
+    }
+    cFrame_Buffer frame;
+    int across = width / size;
+    int down = height / size;
+    for (int blitter_index = 0; blitter_index < Count_Blitters(); blitter_index++) {
+      const sBlitter* blitter = Get_Blitter(blitter_index);
+      if (!blitter) {
+        std::cout << BLITTERS[blitter_index].name << ": not supported" << std::endl;
+        continue;
+      }
+      frame.blitter = blitter;
+      for (int indexed = 0; indexed < 2; indexed++) {
+        std::string label = std::string(blitter->name) + (indexed ? " indexed " : " ");
+        frame.indexed = (indexed == 1);
+        frame.Resize(width, height);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++) {
+          frame.Clear((uint32_t)round);
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << label << "clear: " << (long long)((double)width * height * rounds / std::max(elapsed, 1e-9)) << " pixels/s" << std::endl;
+        for (int mode = eDRAW_OPAQUE; mode <= eDRAW_FLIP_TRANSPARENT; mode++) {
+          start = std::chrono::steady_clock::now();
+          for (int round = 0; round < rounds; round++) {
+            for (int sprite_index = 0; sprite_index < across * down; sprite_index++) {
+              frame.Blit(&cells[0], size, size, size, (sprite_index % across) * size, (sprite_index / across) * size, mode);
+            }
+          }
+          elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+          std::cout << label << DRAW_MODE_NAMES[mode] << ": " <<
+            (long long)((double)size * size * across * down * rounds / std::max(elapsed, 1e-9)) << " pixels/s" << std::endl;
+        }
+        if (frame.indexed) {
+          std::vector<sRegion> screen(1);
+          screen[0].x = 0;
+          screen[0].y = 0;
+          screen[0].width = width;
+          screen[0].height = height;
+          start = std::chrono::steady_clock::now();
+          for (int round = 0; round < rounds; round++) {
+            frame.Expand(screen);
+          }
+          elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+          std::cout << label << "expand: " << (long long)((double)width * height * rounds / std::max(elapsed, 1e-9)) << " pixels/s" << std::endl;
+        }
       }
-      case eADDRESS_OBJECT_POINTER: {
-        int prop_index = command.Read_Column();
-        command.Move_To_Next_Row();
-        return this->Get_Object_At_Pointer(address, prop_index);
+    }
+  }
+
+  /**
+   * Checks that every blitter the processor can run draws the same pixels and indices
+   * as the scalar blitter. Spans of every length up to a few vectors are drawn from
+   * every alignment in every draw mode, over a frame that already has pixels so holes
+   * show through. Cells have their high bits set so only the low byte makes an index.
+   * @throws An error naming the first kernel that differs.
+   */
+  void cFrame_Buffer::Check_Blitters() {
+    const int most = 70;
+    const int span = most + 8;
+    const sBlitter* scalar = &BLITTERS[0];
+    std::vector<int> cells(span + 1);
+    uint32_t palette[C_LESH_PALETTE_SIZE];
+    for (int cell_index = 0; cell_index <= span; cell_index++) {
+      cells[cell_index] = ((cell_index * 5) % 3 == 0) ? -1 - cell_index : (cell_index * 0x01030507) & 0x7FFFFFFF;
+    }
+    for (int color_index = 0; color_index < C_LESH_PALETTE_SIZE; color_index++) {
+      palette[color_index] = (uint32_t)(color_index * 0x010101) ^ 0x5A3C00;
+    }
+    for (int blitter_index = 1; blitter_index < Count_Blitters(); blitter_index++) {
+      const sBlitter* blitter = Get_Blitter(blitter_index);
+      if (!blitter) {
+        std::cout << BLITTERS[blitter_index].name << ": not supported" << std::endl;
+        continue;
       }
-      default: {
-        throw cError("Invalid store mode " + Number_To_Text(mode) + ".");
+      for (int count = 0; count <= most; count++) {
+        for (int offset = 0; offset < 4; offset++) {
+          std::string where = std::string(blitter->name) + " with " + Number_To_Text(count) + " pixels at " + Number_To_Text(offset);
+          std::vector<uint32_t> expected(span, 0x123456);
+          std::vector<uint32_t> actual(span, 0x123456);
+          scalar->fill(&expected[offset], count, 0xABCDEF);
+          blitter->fill(&actual[offset], count, 0xABCDEF);
+          if (expected != actual) {
+            throw cError("Fill differs for " + where + ".");
+          }
+          for (int mode = eDRAW_OPAQUE; mode <= eDRAW_FLIP_TRANSPARENT; mode++) {
+            const int* source = (mode & eDRAW_FLIP) ? &cells[offset + count] : &cells[offset + 1];
+            std::vector<uint32_t> expected_pixels(span, 0x123456);
+            std::vector<uint32_t> actual_pixels(span, 0x123456);
+            scalar->spans[mode](&expected_pixels[offset], source, count);
+            blitter->spans[mode](&actual_pixels[offset], source, count);
+            if (expected_pixels != actual_pixels) {
+              throw cError(std::string(DRAW_MODE_NAMES[mode]) + " span differs for " + where + ".");
+            }
+            std::vector<uint8_t> expected_indices(span, 0x77);
+            std::vector<uint8_t> actual_indices(span, 0x77);
+            scalar->index_spans[mode](&expected_indices[offset], source, count);
+            blitter->index_spans[mode](&actual_indices[offset], source, count);
+            if (expected_indices != actual_indices) {
+              throw cError(std::string(DRAW_MODE_NAMES[mode]) + " index span differs for " + where + ".");
+            }
+            std::vector<uint32_t> expected_colors(span, 0);
+            std::vector<uint32_t> actual_colors(span, 0);
+            scalar->expand(&expected_colors[offset], &expected_indices[offset], palette, count);
+            blitter->expand(&actual_colors[offset], &expected_indices[offset], palette, count);
+            if (expected_colors != actual_colors) {
+              throw cError("Expand differs for " + where + ".");
+            }
+          }
+        }
       }
+      std::cout << blitter->name << ": same as scalar" << std::endl;
     }
-    return command; // Just return the command.
   }
 
+  // **************************************************************************
+  // Presenter Implementation
+  // **************************************************************************
+
   /**
-   * Executes the store command.
-   * @param command The command reference.
-   * @throws An error if the store mode is invalid.
+   * Starts the present thread.
+   * @param display The display that frames are presented on.
+   * @param width The width of the screen.
+   * @param height The height of the screen.
+   * @param count The number of frame buffers, from 2 for double buffering.
+   * @throws An error if there are fewer than two buffers.
    */
-  void cC_Lesh::Store(cTable& command) {
-    cTable& table = this->Get_Table_At_Address(command);
-    int result = this->Eval_Expression(command);
-    table.Rewind(); // Store result at beginning of table.
-    table.Write_Column(result);
+  cPresenter::cPresenter(cFrame_Display* display, int width, int height, int count) {
+    if (count < 2) {
+      throw cError("Need at least 2 present buffers.");
+    }
+    this->display = display;
+    this->slots.resize(count);
+    for (int slot_index = 0; slot_index < count; slot_index++) {
+      this->slots[slot_index].buffer.Resize(width, height);
+      this->slots[slot_index].stale.Set_Screen(width, height);
+      this->slots[slot_index].pending.Set_Screen(width, height);
+    }
+    this->ready = -1;
+    this->presenting = -1;
+    this->stopping = false;
+    this->presented = 0;
+    this->dropped = 0;
+    this->total_latency = 0;
+    this->max_latency = 0;
+    this->thread = std::thread(&cPresenter::Present_Frames, this);
   }
 
   /**
-   * Dump the memory, stack, screen, pointers, and status.
-   * @param command The command reference.
+   * Presents the last frame and stops the present thread.
    */
-  void cC_Lesh::Dump(cTable& command) {
-    // Dump the pointers.
-    std::cout << "command=" << this->command_pointer << std::endl;
-    std::cout << "stack=" << this->stack_pointer << std::endl;
-    // Dump the status.
-    std::cout << "status=" << this->status << std::endl;
-    // Dump the memory.
-    for (int table_index = 0; table_index < this->memory->count; table_index++) {
-      (*this->memory)[table_index].Dump();
+  cPresenter::~cPresenter() {
+    {
+      std::lock_guard<std::mutex> guard(this->lock);
+      this->stopping = true;
     }
-    // Dump the screen.
-    this->pp->Dump();
+    this->signal.notify_all();
+    this->thread.join();
   }
 
   /**
-   * Executes a test command.
-   * @param command The command reference.
-   * @throws An error if the test command is missing something.
+   * Copies a frame into a free buffer and queues it. Only the regions the buffer missed
+   * are copied. A queued frame that was not presented yet is dropped and its damage is
+   * carried into the new frame. This never waits for the display.
+   * @param frame The frame that was drawn.
+   * @param damage The damage of the frame.
    */
-  void cC_Lesh::Test(cTable& command) {
-    int result = this->Eval_Conditional(command);
-    int passed_address = this->Eval_Expression(command);
-    int failed_address = this->Eval_Expression(command);
-    if (passed_address != TAKE_NO_JUMP) {
-      if (result) {
-        this->command_pointer = passed_address;
+  void cPresenter::Publish(cFrame_Buffer& frame, cDamage& damage) {
+    int slot_index = -1;
+    bool replaced = false;
+    {
+      std::lock_guard<std::mutex> guard(this->lock);
+      for (int free_index = 0; free_index < (int)this->slots.size(); free_index++) {
+        if ((free_index != this->presenting) && (free_index != this->ready)) {
+          slot_index = free_index;
+          break;
+        }
+      }
+      if (slot_index == -1) { // Double buffered and the display is busy.
+        slot_index = this->ready;
+        this->ready = -1;
+        this->dropped++;
+        replaced = true;
       }
     }
-    if (failed_address != TAKE_NO_JUMP) {
-      if (!result) {
-        this->command_pointer = failed_address;
+    for (size_t stale_index = 0; stale_index < this->slots.size(); stale_index++) {
+      this->slots[stale_index].stale.Merge(damage);
+    }
+    sFrame_Slot& slot = this->slots[slot_index];
+    slot.buffer.Copy_Regions(frame, slot.stale.Get_Regions());
+    slot.stale.Reset();
+    if (!replaced) {
+      slot.pending.Reset();
+    }
+    slot.pending.Merge(damage);
+    slot.published = std::chrono::steady_clock::now();
+    {
+      std::lock_guard<std::mutex> guard(this->lock);
+      if (this->ready != -1) {
+        slot.pending.Merge(this->slots[this->ready].pending);
+        this->dropped++;
       }
+      this->ready = slot_index;
     }
+    this->signal.notify_all();
   }
 
   /**
-   * Executes a jump command.
-   * @param command The command reference.
-   */
-  void cC_Lesh::Jump(cTable& command) {
-    this->command_pointer = this->Eval_Expression(command);
-  }
-
-  /**
-   * Executes a call command.
-   * @param command The command reference.
+   * Waits until every queued frame was presented.
    */
-  void cC_Lesh::Call(cTable& command) {
-    // Push the command pointer to the stack.
-    this->Stack_Push(this->command_pointer);
-    // Jump to location.
-    this->command_pointer = this->Eval_Expression(command);
+  void cPresenter::Finish() {
+    std::unique_lock<std::mutex> guard(this->lock);
+    while ((this->ready != -1) || (this->presenting != -1)) {
+      this->signal.wait(guard);
+    }
   }
 
   /**
-   * Executes a push command.
-   * @param command The command reference.
-   * @throws An error if there is no more stack space.
+   * Runs on the present thread. Presents the newest frame whenever there is one.
    */
-  void cC_Lesh::Push(cTable& command) {
-    int value = this->Eval_Expression(command);
-    this->Stack_Push(value);
+  void cPresenter::Present_Frames() {
+    std::unique_lock<std::mutex> guard(this->lock);
+    while (true) {
+      while ((this->ready == -1) && !this->stopping) {
+        this->signal.wait(guard);
+      }
+      if (this->ready == -1) {
+        break;
+      }
+      this->presenting = this->ready;
+      this->ready = -1;
+      sFrame_Slot& slot = this->slots[this->presenting];
+      guard.unlock();
+      this->display->Update_Frame(&slot.buffer, slot.pending.Get_Regions());
+      double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - slot.published).count();
+      guard.lock();
+      this->presented++;
+      this->total_latency += latency;
+      this->max_latency = std::max(this->max_latency, latency);
+      this->presenting = -1;
+      this->signal.notify_all();
+    }
   }
 
-  /**
-   * Executes a pop command.
-   * @param command The command reference.
-   * @throws An error if the stack pointer is out of bounds.
-   */
-  void cC_Lesh::Pop(cTable& command) {
-    int value = this->Stack_Pop();
-    cTable& location = this->Get_Table_At_Address(command);
-    location.Write_Column(value);
-  }
+  // **************************************************************************
+  // Glyph Atlas Implementation
+  // **************************************************************************
 
   /**
-   * Executes a return command.
-   * @param command The command reference.
+   * Creates an empty atlas. Text can not be rendered until one is loaded.
    */
-  void cC_Lesh::Return(cTable& command) {
-    (*this->memory)[this->stack_pointer - 1].Rewind();
-    this->command_pointer = (*this->memory)[this->stack_pointer - 1].Read_Column();
-    this->stack_pointer--;
+  cGlyph_Atlas::cGlyph_Atlas() {
+    this->width = 0;
+    this->height = 0;
+    for (int code = 0; code < 256; code++) {
+      this->glyphs[code].x = 0;
+      this->glyphs[code].width = 0;
+    }
   }
 
   /**
-   * Loads a file from disk.
-   * @param command The command reference.
-   * @throws An error if the file mode is incorrect.
+   * Loads an atlas that was baked from a font. The first line is height=<rows>. Each
+   * glyph starts with a line <code>=<width> followed by one line per row where # is ink
+   * and anything else is blank.
+   * @param name The name of the atlas file.
+   * @throws An error if the atlas could not be loaded or a glyph is invalid.
    */
-  void cC_Lesh::Load(cTable& command) {
-    cTable& text = this->Get_Table_At_Address(command);
-    std::string name = C_Lesh_String_To_Cpp_String(text);
-    int mode = this->Eval_Expression(command);
-    int address = this->Eval_Expression(command);
-    switch (mode) {
-      case eFILE_LIST: {
-        this->Load_File_List(name, *this->memory, address);
-        break;
+  void cGlyph_Atlas::Load(std::string name) {
+    std::ifstream atlas_file(name.c_str());
+    if (!atlas_file) {
+      throw cError("Could not load atlas " + name + ".");
+    }
+    std::vector<std::string> rows;
+    std::vector<int> codes;
+    std::vector<int> widths;
+    int height = 0;
+    while (atlas_file) {
+      std::string line;
+      std::getline(atlas_file, line);
+      cArray<std::string> pair = Parse_Sausage_Text(line, "=");
+      if (pair.Count() != 2) {
+        continue;
       }
-      case eFILE_TABLE: {
-        this->Load_Table_List(name, *this->memory, address);
-        break;
+      if (pair[0] == "height") {
+        if (!codes.empty()) {
+          throw cError("Height must come before the glyphs in atlas " + name + ".");
+        }
+        height = Text_To_Number(pair[1]);
+        continue;
       }
-      default: {
-        throw cError("Invalid file mode " + Number_To_Text(mode) + ".");
+      int code = Text_To_Number(pair[0]);
+      int width = Text_To_Number(pair[1]);
+      if ((code < 0) || (code > 255) || (width < 0) || (height <= 0)) {
+        throw cError("Invalid glyph " + pair[0] + " in atlas " + name + ".");
       }
+      for (int row = 0; row < height; row++) {
+        std::string glyph_row;
+        std::getline(atlas_file, glyph_row);
+        glyph_row.resize(width, '.');
+        rows.push_back(glyph_row);
+      }
+      codes.push_back(code);
+      widths.push_back(width);
     }
+    this->Set_Glyphs(codes, widths, rows, height);
   }
 
   /**
-   * Saves a file to disk.
-   * @param command The command reference.
-   * @throws An error if the file could not be saved.
+   * Replaces the glyphs of the atlas. Characters that have no glyph are drawn as blanks
+   * as wide as a space.
+   * @param codes The character code of each glyph.
+   * @param widths The width of each glyph.
+   * @param rows The rows of each glyph, one glyph after the other, where # is ink.
+   * @param height The height of every glyph.
    */
-  void cC_Lesh::Save(cTable& command) {
-    cTable& object = this->Get_Table_At_Address(command);
-    cTable& text = this->Get_Table_At_Address(command);
-    std::string name = C_Lesh_String_To_Cpp_String(text);
-    object.Save_To_File(name);
+  void cGlyph_Atlas::Set_Glyphs(std::vector<int>& codes, std::vector<int>& widths, std::vector<std::string>& rows, int height) {
+    for (int code = 0; code < 256; code++) {
+      this->glyphs[code].x = 0;
+      this->glyphs[code].width = 0;
+    }
+    this->height = height;
+    this->width = 0;
+    for (size_t glyph_index = 0; glyph_index < widths.size(); glyph_index++) {
+      this->width += widths[glyph_index];
+    }
+    this->coverage.assign((size_t)this->width * this->height, 0);
+    int x = 0;
+    for (size_t glyph_index = 0; glyph_index < codes.size(); glyph_index++) {
+      sGlyph& glyph = this->glyphs[codes[glyph_index]];
+      glyph.x = x;
+      glyph.width = widths[glyph_index];
+      for (int row = 0; row < height; row++) {
+        std::string& glyph_row = rows[(glyph_index * height) + row];
+        for (int col = 0; col < glyph.width; col++) {
+          this->coverage[((size_t)row * this->width) + x + col] = (glyph_row[col] == '#') ? 1 : 0;
+        }
+      }
+      x += glyph.width;
+    }
+    for (int code = 0; code < 256; code++) {
+      if (this->glyphs[code].width == 0) {
+        this->glyphs[code].x = -1; // Blank.
+        this->glyphs[code].width = std::max(this->glyphs[(int)' '].width, 1);
+      }
+    }
   }
 
   /**
-   * Executes an input command.
-   * @param the command reference.
+   * Renders text as picture cells. Cells without ink are -1 so the text is drawn
+   * transparent. Glyphs are one cell apart.
+   * @param text The text to render.
+   * @param color The cell value of the ink.
+   * @param cells The cells of the text.
+   * @param width The width of the text.
    */
-  void cC_Lesh::Input(cTable& command) {
-    cTable& value = this->Get_Table_At_Address(command);
-    sSignal signal = this->io->Read_Signal();
-    value.Write_Column(signal.code);
+  void cGlyph_Atlas::Render(std::string& text, int color, std::vector<int>& cells, int& width) {
+    width = 0;
+    for (size_t letter_index = 0; letter_index < text.length(); letter_index++) {
+      width += this->glyphs[(unsigned char)text[letter_index]].width + ((letter_index > 0) ? 1 : 0);
+    }
+    cells.assign((size_t)width * this->height, -1);
+    int x = 0;
+    for (size_t letter_index = 0; letter_index < text.length(); letter_index++) {
+      sGlyph& glyph = this->glyphs[(unsigned char)text[letter_index]];
+      if (glyph.x >= 0) {
+        for (int row = 0; row < this->height; row++) {
+          const uint8_t* ink = &this->coverage[((size_t)row * this->width) + glyph.x];
+          for (int col = 0; col < glyph.width; col++) {
+            if (ink[col]) {
+              cells[((size_t)row * width) + x + col] = color;
+            }
+          }
+        }
+      }
+      x += glyph.width + 1;
+    }
   }
 
+  // **************************************************************************
+  // Text Cache Implementation
+  // **************************************************************************
+
   /**
-   * Executes a refresh command.
-   * @param command The command reference.
+   * Creates an empty text cache.
    */
-  void cC_Lesh::Refresh(cTable& command) {
-    this->io->Update_Display(this->pp);
+  cText_Cache::cText_Cache() {
+    this->hits = 0;
+    this->misses = 0;
   }
 
   /**
-   * Executes a sound command.
-   * @param command The command reference.
+   * Gets rendered text, rendering it only if it was not rendered in that color before.
+   * The cache is emptied when it fills up.
+   * @param atlas The atlas to render with.
+   * @param text The text.
+   * @param color The cell value of the ink.
+   * @return The rendered text.
    */
-  void cC_Lesh::Sound(cTable& command) {
-    cTable& text = this->Get_Table_At_Address(command);
-    std::string name = C_Lesh_String_To_Cpp_String(text);
-    this->io->Play_Sound(name);
+  sText_Image& cText_Cache::Get(cGlyph_Atlas& atlas, std::string& text, int color) {
+    std::pair<std::string, int> key(text, color);
+    std::map<std::pair<std::string, int>, sText_Image>::iterator image = this->images.find(key);
+    if (image != this->images.end()) {
+      this->hits++;
+      return image->second;
+    }
+    this->misses++;
+    if (this->images.size() >= C_LESH_TEXT_CACHE) {
+      this->images.clear();
+    }
+    sText_Image& entry = this->images[key];
+    atlas.Render(text, color, entry.cells, entry.width);
+    entry.height = atlas.height;
+    return entry;
   }
 
   /**
-   * Executes a timeout command.
-   * @param command The command reference.
+   * Empties the cache and its statistics.
    */
-  void cC_Lesh::Timeout(cTable& command) {
-    int delay = this->Eval_Expression(command);
-    this->io->Timeout(delay);
+  void cText_Cache::Clear() {
+    this->images.clear();
+    this->hits = 0;
+    this->misses = 0;
   }
 
+  // **************************************************************************
+  // Null I/O Implementation
+  // **************************************************************************
+
   /**
-   * Executes an output command.
-   * @param command The command reference.
+   * Creates an I/O control that needs no display, sound or keyboard.
+   * @param input The name of the input script. Each line has a signal code. Use an empty name for no input.
+   * @param log The name of the file text output is written to.
+   * @throws An error if the input script or log could not be opened.
    */
-  void cC_Lesh::Output(cTable& command) {
-    cTable& text = this->Get_Table_At_Address(command);
-    std::string output = C_Lesh_String_To_Cpp_String(text);
-    int x = this->Eval_Expression(command);
-    int y = this->Eval_Expression(command);
-    int red = this->Eval_Expression(command);
-    int green = this->Eval_Expression(command);
-    int blue = this->Eval_Expression(command);
-    this->io->Output_Text(output, x, y, red, green, blue);
+  cNull_IO::cNull_IO(std::string input, std::string log) {
+    this->frame_count = 0;
+    this->seed = 1;
+    if (input.length() > 0) {
+      cFile file(input);
+      file.Read();
+      while (file.Has_More_Lines()) {
+        this->signals.push_back(Text_To_Number(file.Get_Line()));
+      }
+    }
+    this->signal_index = 0;
+    this->log.open(log.c_str());
+    if (!this->log) {
+      throw cError("Could not open log " + log + ".");
+    }
   }
 
   /**
-   * Executes a string command.
-   * @param command The command reference.
-   */
-  void cC_Lesh::String(cTable& command) {
-    cTable& text_1 = this->Get_Table_At_Address(command);
-    cTable& text_2 = this->Get_Table_At_Address(command);
-    std::string str_1 = C_Lesh_String_To_Cpp_String(text_1);
-    std::string str_2 = C_Lesh_String_To_Cpp_String(text_2);
-    cTable& result = this->Get_Table_At_Address(command);
-    bool test = (str_1 == str_2);
-    result.Write_Column((int)test);
+   * Gets a random number. The sequence is the same on every run.
+   * @param lower The lower bound.
+   * @param upper The upper bound.
+   * @return A number between the bounds, inclusive.
+   */
+  int cNull_IO::Get_Random_Number(int lower, int upper) {
+    this->seed = (this->seed * 1103515245) + 12345;
+    int range = upper - lower + 1;
+    return (range > 0) ? lower + (int)((this->seed >> 16) % (unsigned int)range) : lower;
   }
 
   /**
-   * Executes a palette command.
-   * @param command The command reference.
+   * Reads the next signal from the input script.
+   * @return The signal. The code is zero once the script runs out.
    */
-  void cC_Lesh::Palette(cTable& command) {
-    cTable& text = this->Get_Table_At_Address(command);
-    std::string name = C_Lesh_String_To_Cpp_String(text);
-    this->pp->Load_Palette(name);
+  sSignal cNull_IO::Read_Signal() {
+    sSignal signal;
+    signal.code = 0;
+    if (this->signal_index < (int)this->signals.size()) {
+      signal.code = this->signals[this->signal_index++];
+    }
+    return signal;
   }
 
   /**
-   * Executes a draw command.
-   * @param command The command reference.
+   * Counts a frame instead of presenting it.
+   * @param pp The picture processor.
    */
-  void cC_Lesh::Draw(cTable& command) {
-    cTable& picture = this->Get_Table_At_Address(command);
-    int x = this->Eval_Expression(command);
-    int y = this->Eval_Expression(command);
-    int mode = this->Eval_Expression(command);
-    this->pp->Draw_Picture(picture, x, y, mode);
+  void cNull_IO::Update_Display(cPicture_Processor* pp) {
+    this->frame_count++;
   }
 
   /**
-   * Executes a clear command.
-   * @param command The command reference.
+   * Counts a frame drawn by C-Lesh.
+   * @param frame The frame.
+   * @param regions The regions that changed.
    */
-  void cC_Lesh::Clear(cTable& command) {
-    sColor color;
-    color.red = this->Eval_Expression(command);
-    color.green = this->Eval_Expression(command);
-    color.blue = this->Eval_Expression(command);
-    this->pp->Clear_Screen(color);
+  void cNull_IO::Update_Frame(cFrame_Buffer* frame, std::vector<sRegion>& regions) {
+    this->frame_count++;
   }
 
   /**
-   * Executes a resize command.
-   * @param command The command reference.
+   * Discards a sound.
+   * @param name The name of the sound.
    */
-  void cC_Lesh::Resize(cTable& command) {
-    cTable& table = this->Get_Table_At_Address(command);
-    int width = this->Eval_Expression(command);
-    int height = this->Eval_Expression(command);
-    table.Resize(width, height);
+  void cNull_IO::Play_Sound(std::string name) {
+    // Nothing to play.
   }
 
   /**
-   * Executes a column command.
-   * @param command The command reference.
+   * Skips a timeout so programs run as fast as possible.
+   * @param delay The delay in milliseconds.
    */
-  void cC_Lesh::Column(cTable& command) {
-    cTable& table = this->Get_Table_At_Address(command);
-    int index = this->Eval_Expression(command);
-    cTable& result = this->Get_Table_At_Address(command);
-    table.Move_To_Column(index);
-    int number = table.Read_Column();
-    result.Write_Column(number);
+  void cNull_IO::Timeout(int delay) {
+    // Do not wait.
   }
 
   /**
-   * Executes a stop command.
-   * @param command The command reference.
+   * Writes text output to the log.
+   * @param text The text to output.
+   * @param x The x coordinate of the text.
+   * @param y The y coordinate of the text.
+   * @param red The red component of the color.
+   * @param green The green component of the color.
+   * @param blue The blue component of the color.
    */
-  void cC_Lesh::Stop(cTable& command) {
-    this->status = eSTATUS_DONE;
+  void cNull_IO::Output_Text(std::string text, int x, int y, int red, int green, int blue) {
+    this->log << this->frame_count << " " << x << "," << y << ": " << text << std::endl;
   }
 
+  // **************************************************************************
+  // Allegro Frame I/O Implementation
+  // **************************************************************************
+
   /**
-   * Pushes a value on the stack.
-   * @param value The value to push.
+   * Creates the Allegro I/O control so it can present frames drawn by C-Lesh as well.
+   * @param title The title of the window.
+   * @param width The width of the screen.
+   * @param height The height of the screen.
+   * @param scale The scale of the window.
+   * @param font The name of the font.
    */
-  void cC_Lesh::Stack_Push(int value) {
-    (*this->memory)[this->stack_pointer].Rewind();
-    (*this->memory)[this->stack_pointer].Write_Column(value);
-    this->stack_pointer++;
+  cAllegro_Frame_IO::cAllegro_Frame_IO(std::string title, int width, int height, int scale, std::string font) :
+    cAllegro_IO(title, width, height, scale, font) {
+    this->bitmap = NULL;
+    this->font = font;
   }
 
   /**
-   * Pops a value from the stack.
-   * @return The value at the top of the stack.
+   * Frees the bitmap frames are uploaded to.
    */
-  int cC_Lesh::Stack_Pop() {
-    (*this->memory)[this->stack_pointer - 1].Rewind();
-    int value = (*this->memory)[this->stack_pointer - 1].Read_Column();
-    this->stack_pointer--;
-    return value;
+  cAllegro_Frame_IO::~cAllegro_Frame_IO() {
+    if (this->bitmap) {
+      al_destroy_bitmap(this->bitmap);
+    }
   }
 
   /**
-   * Loads a file into memory.
-   * @param name The name of the file to load.
-   * @param memory The memory to load the file into.
-   * @param address The address to load the file into.
-   * @throws An error if the file could not be loaded.
+   * Uploads the regions of a frame that changed to a video bitmap, then scales the
+   * bitmap onto the window. The pixels of the frame are already in the format of the
+   * bitmap so each row is a single copy.
+   * @param frame The frame.
+   * @param regions The regions that changed.
+   * @throws An error if the bitmap could not be created.
    */
-  void cC_Lesh::Load_File_List(std::string name, cMemory& memory, int address) {
-    cFile file(name);
-    file.Read();
-    while (file.Has_More_Lines()) {
-      std::string fname = file.Get_Line();
-      cTable& table = memory[address++];
-      table.Load_From_File(fname);
+  void cAllegro_Frame_IO::Update_Frame(cFrame_Buffer* frame, std::vector<sRegion>& regions) {
+    ALLEGRO_DISPLAY* display = al_get_current_display();
+    if (!this->bitmap) {
+      int flags = al_get_new_bitmap_flags();
+      al_set_new_bitmap_flags(ALLEGRO_VIDEO_BITMAP);
+      this->bitmap = al_create_bitmap(frame->width, frame->height);
+      al_set_new_bitmap_flags(flags);
+      if (!this->bitmap) {
+        throw cError("Could not create frame bitmap.");
+      }
+    }
+    for (size_t region_index = 0; region_index < regions.size(); region_index++) {
+      sRegion& region = regions[region_index];
+      ALLEGRO_LOCKED_REGION* locked = al_lock_bitmap_region(this->bitmap, region.x, region.y, region.width, region.height,
+        ALLEGRO_PIXEL_FORMAT_XRGB_8888, ALLEGRO_LOCK_WRITEONLY);
+      if (locked) {
+        for (int row_index = 0; row_index < region.height; row_index++) {
+          const uint32_t* source = &frame->pixels[((region.y + row_index) * frame->width) + region.x];
+          std::memcpy((char*)locked->data + (row_index * locked->pitch), source, region.width * sizeof(uint32_t));
+        }
+        al_unlock_bitmap(this->bitmap);
+      }
     }
+    al_set_target_backbuffer(display);
+    al_draw_scaled_bitmap(this->bitmap, 0, 0, frame->width, frame->height, 0, 0, al_get_display_width(display), al_get_display_height(display), 0);
+    al_flip_display();
   }
 
   /**
-   * Loads a list of tables from a single file.
-   * @param name The name of the file to load the tables from.
-   * @param memory The memory to load the tables to.
-   * @param address The address to load the tables to.
-   * @throws An error if the tables could not be loaded.
+   * Bakes an atlas from the font text is output with. Each printable character is drawn
+   * on its own memory bitmap and every pixel that is at least half lit becomes ink.
+   * @param atlas The atlas to bake into.
+   * @throws An error if the font could not be loaded.
    */
-  void cC_Lesh::Load_Table_List(std::string name, cMemory& memory, int address) {
-    cFile file(name);
-    file.Read();
-    while (file.Has_More_Lines()) {
-      cTable& table = memory[address++];
-      table.Rewind();
-      // Read dimensions of table.
-      std::string dimensions = file.Get_Line();
-      cArray<std::string> pair = Parse_Sausage_Text(dimensions, "x");
-      if (pair.Count() == 2) {
-        int width = Text_To_Number(pair[0]);
-        int height = Text_To_Number(pair[1]);
-        table.Resize(width, height);
+  void cAllegro_Frame_IO::Bake_Atlas(cGlyph_Atlas& atlas) {
+    std::string name = this->font + ".ttf";
+    ALLEGRO_FONT* font = al_load_ttf_font(name.c_str(), C_LESH_FONT_SIZE, 0);
+    if (!font) {
+      throw cError("Could not load font " + name + ".");
+    }
+    int height = al_get_font_line_height(font);
+    std::vector<int> codes;
+    std::vector<int> widths;
+    std::vector<std::string> rows;
+    ALLEGRO_BITMAP* target = al_get_target_bitmap();
+    int flags = al_get_new_bitmap_flags();
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    for (int code = ' '; code <= '~'; code++) {
+      char letter[2] = { (char)code, '\0' };
+      int width = al_get_text_width(font, letter);
+      ALLEGRO_BITMAP* glyph = (width > 0) ? al_create_bitmap(width, height) : NULL;
+      if (!glyph) {
+        continue; // Drawn as a blank.
+      }
+      al_set_target_bitmap(glyph);
+      al_clear_to_color(al_map_rgb(0, 0, 0));
+      al_draw_text(font, al_map_rgb(255, 255, 255), 0, 0, ALLEGRO_ALIGN_LEFT, letter);
+      ALLEGRO_LOCKED_REGION* locked = al_lock_bitmap(glyph, ALLEGRO_PIXEL_FORMAT_XRGB_8888, ALLEGRO_LOCK_READONLY);
+      if (locked) {
         for (int row_index = 0; row_index < height; row_index++) {
-          std::string line = file.Get_Line();
-          cArray<std::string> columns = Parse_Sausage_Text(line, " ");
-          int column_count = columns.Count();
-          for (int column_index = 0; column_index < column_count; column_index++) {
-            table.Write_Column(Text_To_Number(columns[column_index]));
+          const uint32_t* pixels = (const uint32_t*)((const char*)locked->data + (row_index * locked->pitch));
+          std::string glyph_row(width, '.');
+          for (int col_index = 0; col_index < width; col_index++) {
+            if (((pixels[col_index] >> 8) & 0xFF) >= 128) { // Green is as lit as the pixel.
+              glyph_row[col_index] = '#';
+            }
           }
-          table.Move_To_Next_Row();
+          rows.push_back(glyph_row);
         }
+        al_unlock_bitmap(glyph);
+        codes.push_back(code);
+        widths.push_back(width);
       }
-      else {
-        throw cError("Missing width or height of table in " + name + ".");
-      }
-      table.Rewind(); // Reset the table after writing to it.
+      al_destroy_bitmap(glyph);
     }
+    al_set_new_bitmap_flags(flags);
+    al_set_target_bitmap(target);
+    al_destroy_font(font);
+    atlas.Set_Glyphs(codes, widths, rows, height);
   }
 
   /**
-   * Extracts a C-Lesh string and converts it to a C++ string.
-   * @param table The table containing the string.
-   * @return The C++ string.
+   * Tells whether frames can be presented from another thread. The Allegro display
+   * belongs to the thread that created it.
+   * @return Always false.
    */
-  std::string cC_Lesh::C_Lesh_String_To_Cpp_String(cTable& table) {
-    std::string text = "";
-    int letter_count = table.Read_Column();
-    while (letter_count > 0) {
-      int letter = table.Read_Column();
-      if (letter == '@') { // Placeholder
-        int number = this->Stack_Pop();
-        text += Number_To_Text(number); // Replace with number.
-      }
-      else {
-        text += (char)letter;
-      }
-    }
-    return text;
+  bool cAllegro_Frame_IO::Can_Present_On_Thread() {
+    return false;
   }
 
+#ifdef C_LESH_PROFILE
   // **************************************************************************
-  // Memory Implmentation
+  // Profiler Implementation
   // **************************************************************************
 
+  static const char* CODE_NAMES[] = {
+    "store", "dump", "test", "jump", "call", "return", "push", "pop", "load", "save", "input",
+    "refresh", "sound", "timeout", "output", "string", "palette", "draw", "clear", "resize",
+    "column", "stop", "copy", "block", "fill", "vector", "increment_test", "push_call", "multi_pop"
+  };
+
+  static const char* OPERATOR_NAMES[] = {
+    "none", "add", "subtract", "multiply", "divide", "remainder", "random", "cosine", "sine"
+  };
+
   /**
-   * Creates a new memory module of the specified size.
+   * Creates a profiler.
    * @param count The number of tables in memory.
-   * @param width The width of each table.
-   * @param height The height of each table.
    */
-  cMemory::cMemory(int count, int width, int height) {
-    this->count = count;
-    this->tables = new cTable* [count];
-    for (int table_index = 0; table_index < count; table_index++) {
-      this->tables[table_index] = new cTable(width, height);
+  cProfiler::cProfiler(int count) {
+    this->commands.resize(count);
+    this->reads.resize(count);
+    this->writes.resize(count);
+    this->Reset();
+  }
+
+  /**
+   * Clears out all counts and times.
+   */
+  void cProfiler::Reset() {
+    sProfile_Count zero = { 0, 0 };
+    std::fill(this->codes, this->codes + eCODE_MULTI_POP + 1, zero);
+    std::fill(this->operators, this->operators + eOPERATOR_SINE + 1, zero);
+    std::fill(this->commands.begin(), this->commands.end(), zero);
+    std::fill(this->reads.begin(), this->reads.end(), 0);
+    std::fill(this->writes.begin(), this->writes.end(), 0);
+    this->current_address = -1;
+    this->current_code = 0;
+  }
+
+  /**
+   * Starts timing a command. The command before it is finished first.
+   * @param address The address of the command.
+   * @param code The command code.
+   */
+  void cProfiler::Begin_Command(int address, int code) {
+    this->End_Command();
+    this->current_address = address;
+    this->current_code = code;
+    this->start = std::chrono::steady_clock::now();
+  }
+
+  /**
+   * Finishes timing the current command, if there is one.
+   */
+  void cProfiler::End_Command() {
+    if (this->current_address >= 0) {
+      long long time = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->start).count();
+      this->codes[this->current_code].count++;
+      this->codes[this->current_code].time += time;
+      if (this->current_address < (int)this->commands.size()) {
+        this->commands[this->current_address].count++;
+        this->commands[this->current_address].time += time;
+      }
+      this->current_address = -1;
     }
   }
 
   /**
-   * Frees the memory module.
+   * Counts an operator that was applied.
+   * @param op The operator.
+   * @param start The time the operator was started.
    */
-  cMemory::~cMemory() {
-    for (int table_index = 0; table_index < this->count; table_index++) {
-      delete this->tables[table_index];
+  void cProfiler::Count_Operator(int op, std::chrono::steady_clock::time_point start) {
+    if ((op >= eOPERATOR_NONE) && (op <= eOPERATOR_SINE)) {
+      this->operators[op].count++;
+      this->operators[op].time += (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
     }
-    delete[] this->tables;
   }
 
   /**
-   * Clears out the memory.
+   * Sorts profile counts by time, most expensive first. Counts that are zero are left out.
+   * @param counts The counts to sort.
+   * @param size The number of counts.
+   * @param order The indexes of the counts in sorted order.
    */
-  void cMemory::Clear() {
-    for (int table_index = 0; table_index < this->count; table_index++) {
-      this->tables[table_index]->Clear();
+  static void Sort_Profile(const sProfile_Count* counts, int size, std::vector<int>& order) {
+    std::vector<std::pair<std::pair<long long, long long>, int> > keys;
+    for (int count_index = 0; count_index < size; count_index++) {
+      if (counts[count_index].count > 0) {
+        keys.push_back(std::make_pair(std::make_pair(counts[count_index].time, counts[count_index].count), -count_index));
+      }
+    }
+    std::sort(keys.begin(), keys.end());
+    order.clear();
+    for (int key_index = (int)keys.size() - 1; key_index >= 0; key_index--) {
+      order.push_back(-keys[key_index].second);
     }
   }
 
   /**
-   * Accesses a table from memory given an address.
-   * @param address The address of the table to access.
-   * @return A reference to the table at the address.
-   * @throws An error if the address is invalid.
+   * Sorts the tables by the number of accesses, most accessed first. Tables that were
+   * never accessed are left out.
+   * @param reads The reads of each table.
+   * @param writes The writes of each table.
+   * @param order The addresses of the tables in sorted order.
    */
-  cTable& cMemory::operator[](int address) {
-    if ((address < 0) || (address >= this->count)) {
-      throw cError("Invalid address accessed at " + Number_To_Text(address) + ".");
+  static void Sort_Accesses(std::vector<long long>& reads, std::vector<long long>& writes, std::vector<int>& order) {
+    std::vector<std::pair<long long, int> > keys;
+    for (int address = 0; address < (int)reads.size(); address++) {
+      if ((reads[address] + writes[address]) > 0) {
+        keys.push_back(std::make_pair(reads[address] + writes[address], -address));
+      }
+    }
+    std::sort(keys.begin(), keys.end());
+    order.clear();
+    for (int key_index = (int)keys.size() - 1; key_index >= 0; key_index--) {
+      order.push_back(-keys[key_index].second);
+    }
+  }
+
+  /**
+   * Writes the profile as a report sorted by time.
+   * @param name The name of the report file.
+   * @throws An error if the report could not be written.
+   */
+  void cProfiler::Write_Report(std::string name) {
+    std::ofstream report(name.c_str());
+    if (!report) {
+      throw cError("Could not write profile " + name + ".");
+    }
+    std::vector<int> order;
+    Sort_Profile(this->codes, eCODE_MULTI_POP + 1, order);
+    report << "Commands (count, ns, ns/command):" << std::endl;
+    for (size_t order_index = 0; order_index < order.size(); order_index++) {
+      sProfile_Count& count = this->codes[order[order_index]];
+      report << "  " << CODE_NAMES[order[order_index]] << " " << count.count << " " << count.time << " " << (count.time / count.count) << std::endl;
+    }
+    Sort_Profile(this->operators, eOPERATOR_SINE + 1, order);
+    report << "Operators (count, ns, ns/operator):" << std::endl;
+    for (size_t order_index = 0; order_index < order.size(); order_index++) {
+      sProfile_Count& count = this->operators[order[order_index]];
+      report << "  " << OPERATOR_NAMES[order[order_index]] << " " << count.count << " " << count.time << " " << (count.time / count.count) << std::endl;
+    }
+    Sort_Profile(&this->commands[0], (int)this->commands.size(), order);
+    report << "Addresses (count, ns, ns/command):" << std::endl;
+    for (size_t order_index = 0; order_index < order.size(); order_index++) {
+      sProfile_Count& count = this->commands[order[order_index]];
+      report << "  " << order[order_index] << " " << count.count << " " << count.time << " " << (count.time / count.count) << std::endl;
+    }
+    Sort_Accesses(this->reads, this->writes, order);
+    report << "Tables (reads, writes):" << std::endl;
+    for (size_t order_index = 0; order_index < order.size(); order_index++) {
+      int address = order[order_index];
+      report << "  " << address << " " << this->reads[address] << " " << this->writes[address] << std::endl;
+    }
+  }
+
+  /**
+   * Writes the profile as CSV. Every line has the kind, the key, the count and the time
+   * in nanoseconds. Tables have their reads and writes instead of count and time.
+   * @param name The name of the CSV file.
+   * @throws An error if the file could not be written.
+   */
+  void cProfiler::Write_Csv(std::string name) {
+    std::ofstream csv(name.c_str());
+    if (!csv) {
+      throw cError("Could not write profile " + name + ".");
+    }
+    std::vector<int> order;
+    csv << "kind,key,count,time" << std::endl;
+    Sort_Profile(this->codes, eCODE_MULTI_POP + 1, order);
+    for (size_t order_index = 0; order_index < order.size(); order_index++) {
+      csv << "command," << CODE_NAMES[order[order_index]] << "," << this->codes[order[order_index]].count << "," << this->codes[order[order_index]].time << std::endl;
+    }
+    Sort_Profile(this->operators, eOPERATOR_SINE + 1, order);
+    for (size_t order_index = 0; order_index < order.size(); order_index++) {
+      csv << "operator," << OPERATOR_NAMES[order[order_index]] << "," << this->operators[order[order_index]].count << "," << this->operators[order[order_index]].time << std::endl;
+    }
+    Sort_Profile(&this->commands[0], (int)this->commands.size(), order);
+    for (size_t order_index = 0; order_index < order.size(); order_index++) {
+      csv << "address," << order[order_index] << "," << this->commands[order[order_index]].count << "," << this->commands[order[order_index]].time << std::endl;
+    }
+    Sort_Accesses(this->reads, this->writes, order);
+    for (size_t order_index = 0; order_index < order.size(); order_index++) {
+      csv << "table," << order[order_index] << "," << this->reads[order[order_index]] << "," << this->writes[order[order_index]] << std::endl;
+    }
+  }
+
+  /**
+   * Writes the profile as JSON.
+   * @param name The name of the JSON file.
+   * @throws An error if the file could not be written.
+   */
+  void cProfiler::Write_Json(std::string name) {
+    std::ofstream json(name.c_str());
+    if (!json) {
+      throw cError("Could not write profile " + name + ".");
+    }
+    std::vector<int> order;
+    Sort_Profile(this->codes, eCODE_MULTI_POP + 1, order);
+    json << "{" << std::endl << "  \"commands\": [";
+    for (size_t order_index = 0; order_index < order.size(); order_index++) {
+      sProfile_Count& count = this->codes[order[order_index]];
+      json << ((order_index > 0) ? "," : "") << std::endl << "    { \"code\": \"" << CODE_NAMES[order[order_index]] << "\", \"count\": " << count.count << ", \"time\": " << count.time << " }";
+    }
+    Sort_Profile(this->operators, eOPERATOR_SINE + 1, order);
+    json << std::endl << "  ]," << std::endl << "  \"operators\": [";
+    for (size_t order_index = 0; order_index < order.size(); order_index++) {
+      sProfile_Count& count = this->operators[order[order_index]];
+      json << ((order_index > 0) ? "," : "") << std::endl << "    { \"operator\": \"" << OPERATOR_NAMES[order[order_index]] << "\", \"count\": " << count.count << ", \"time\": " << count.time << " }";
+    }
+    Sort_Profile(&this->commands[0], (int)this->commands.size(), order);
+    json << std::endl << "  ]," << std::endl << "  \"addresses\": [";
+    for (size_t order_index = 0; order_index < order.size(); order_index++) {
+      sProfile_Count& count = this->commands[order[order_index]];
+      json << ((order_index > 0) ? "," : "") << std::endl << "    { \"address\": " << order[order_index] << ", \"count\": " << count.count << ", \"time\": " << count.time << " }";
+    }
+    Sort_Accesses(this->reads, this->writes, order);
+    json << std::endl << "  ]," << std::endl << "  \"tables\": [";
+    for (size_t order_index = 0; order_index < order.size(); order_index++) {
+      int address = order[order_index];
+      json << ((order_index > 0) ? "," : "") << std::endl << "    { \"address\": " << address << ", \"reads\": " << this->reads[address] << ", \"writes\": " << this->writes[address] << " }";
     }
-    return *(this->tables[address]);
+    json << std::endl << "  ]" << std::endl << "}" << std::endl;
   }
+#endif
 
 }
\ No newline at end of file
@@ -1,145 +1,811 @@
-// ============================================================================
-// C-Lesh (Definitions)
-// Programmed by Francois Lamini
-// ============================================================================
-
-#include "..\Code_Helper\Codeloader.hpp"
-#include "..\Code_Helper\Allegro.hpp"
-
-namespace Codeloader {
-
-  enum eCode {
-    eCODE_STORE,
-    eCODE_DUMP,
-    eCODE_TEST,
-    eCODE_JUMP,
-    eCODE_CALL,
-    eCODE_RETURN,
-    eCODE_PUSH,
-    eCODE_POP,
-    eCODE_LOAD,
-    eCODE_SAVE,
-    eCODE_INPUT,
-    eCODE_REFRESH,
-    eCODE_SOUND,
-    eCODE_TIMEOUT,
-    eCODE_OUTPUT,
-    eCODE_STRING,
-    eCODE_PALETTE,
-    eCODE_DRAW,
-    eCODE_CLEAR,
-    eCODE_RESIZE,
-    eCODE_COLUMN,
-    eCODE_STOP
-  };
-
-  enum eOperator {
-    eOPERATOR_NONE,
-    eOPERATOR_ADD,
-    eOPERATOR_SUBTRACT,
-    eOPERATOR_MULTIPLY,
-    eOPERATOR_DIVIDE,
-    eOPERATOR_REMAINDER,
-    eOPERATOR_RANDOM,
-    eOPERATOR_COSINE,
-    eOPERATOR_SINE
-  };
-
-  enum eAddress {
-    eADDRESS_VALUE,
-    eADDRESS_IMMEDIATE,
-    eADDRESS_POINTER,
-    eADDRESS_STACK,
-    eADDRESS_OBJECT_IMMEDIATE,
-    eADDRESS_OBJECT_POINTER
-  };
-
-  enum eLogic_Operator {
-    eLOGIC_NONE,
-    eLOGIC_AND,
-    eLOGIC_OR
-  };
-
-  enum eTest {
-    eTEST_EQUALS,
-    eTEST_NOT,
-    eTEST_LESS,
-    eTEST_GREATER,
-    eTEST_LESS_OR_EQUAL,
-    eTEST_GREATER_OR_EQUAL
-  };
-
-  enum eFile_Mode {
-    eFILE_LIST,
-    eFILE_TABLE
-  };
-
-  class cMemory {
-
-    public:
-      cTable** tables;
-      int count;
-
-      cMemory(int count, int width, int height);
-      ~cMemory();
-      void Clear();
-      cTable& operator[](int address);
-
-  };
-  
-  class cC_Lesh {
-
-    public:
-      cMemory* memory;
-      cPicture_Processor* pp;
-      cIO_Control* io;
-      int command_pointer;
-      int stack_pointer;
-      int status;
-
-      cC_Lesh(cPicture_Processor* pp, cIO_Control* io, std::string config);
-      ~cC_Lesh();
-      void Load_Program(std::string name);
-      void Execute(int timeout);
-      void Interpret();
-      int Eval_Expression(cTable& command);
-      int Eval_Operand(cTable& command);
-      int Eval_Conditional(cTable& command);
-      int Eval_Condition(cTable& command);
-      cTable& Get_Table_At_Immediate_Address(int address);
-      cTable& Get_Table_At_Pointer(int address);
-      cTable& Get_Table_At_Stack(int address);
-      cTable& Get_Object_At_Immediate_Address(int address, int prop_index);
-      cTable& Get_Object_At_Pointer(int address, int prop_index);
-      cTable& Get_Table_At_Address(cTable& command);
-      void Store(cTable& command);
-      void Dump(cTable& command);
-      void Test(cTable& command);
-      void Jump(cTable& command);
-      void Call(cTable& command);
-      void Push(cTable& command);
-      void Pop(cTable& command);
-      void Return(cTable& command);
-      void Load(cTable& command);
-      void Save(cTable& command);
-      void Input(cTable& command);
-      void Refresh(cTable& command);
-      void Sound(cTable& command);
-      void Timeout(cTable& command);
-      void Output(cTable& command);
-      void String(cTable& command);
-      void Palette(cTable& command);
-      void Draw(cTable& command);
-      void Clear(cTable& command);
-      void Resize(cTable& command);
-      void Column(cTable& command);
-      void Stop(cTable& command);
-      void Stack_Push(int value);
-      int Stack_Pop();
-      void Load_File_List(std::string name, cMemory& memory, int address);
-      void Load_Table_List(std::string name, cMemory& memory, int address);
-      std::string C_Lesh_String_To_Cpp_String(cTable& table);
-
-  };
-
+// ============================================================================
+// C-Lesh (Definitions)
+// Programmed by Francois Lamini
+// ============================================================================
+
+#include "..\Code_Helper\Codeloader.hpp"
+#include "..\Code_Helper\Allegro.hpp"
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Define C_LESH_SWITCH_DISPATCH to run one command per Interpret() call instead of the threaded engine.
+#ifndef C_LESH_SWITCH_DISPATCH
+  #define C_LESH_THREADED_DISPATCH
+#endif
+#define C_LESH_DISPATCH_BATCH 256
+#define C_LESH_CHECK_MICROSECONDS 250
+#define C_LESH_MAX_CHECK_INTERVAL 1048576
+#define C_LESH_DAMAGE_REGIONS 16
+#define C_LESH_PIXEL_BYTES 4
+#define C_LESH_PRESENT_BUFFERS 3
+#define C_LESH_PALETTE_SIZE 256
+#define C_LESH_TEXT_CACHE 256
+#define C_LESH_FONT_SIZE 16
+#define C_LESH_SLOT_SHIFT 12 // Slots are set up 4096 at a time.
+
+// Define C_LESH_JIT to compile hot blocks to x86-64 code. Profiling builds always interpret.
+#if defined(C_LESH_JIT) && (defined(C_LESH_PROFILE) || defined(C_LESH_SWITCH_DISPATCH) || !(defined(__x86_64__) || defined(_M_X64)))
+  #undef C_LESH_JIT
+#endif
+#ifdef C_LESH_JIT
+  #define C_LESH_JIT_ENTER() if (this->Enter_Jit(count, executed)) return executed
+#else
+  #define C_LESH_JIT_ENTER()
+#endif
+// Native programs translated to C++ use these around every command.
+#define C_LESH_NATIVE_BEGIN(address, next) \
+  cmd_##address: \
+  if ((executed >= count) || C_LESH_NATIVE_FAULTED(clsh)) { \
+    return executed; \
+  } \
+  executed++; \
+  clsh.command_pointer = next
+#define C_LESH_NATIVE_END(next) \
+  if ((clsh.command_pointer != next) || (clsh.native == NULL)) { \
+    goto dispatch; \
+  }
+#define C_LESH_JIT_THRESHOLD 64
+#define C_LESH_JIT_BLOCK_SIZE 64
+#define C_LESH_JIT_CODE_SIZE 1048576
+
+// Define C_LESH_PROFILE to count and time commands, operators and table accesses.
+#ifdef C_LESH_PROFILE
+  #define C_LESH_PROFILE_COMMAND(address, code) this->profiler->Begin_Command(address, code)
+  #define C_LESH_PROFILE_END() this->profiler->End_Command()
+  #define C_LESH_PROFILE_OPERATOR_START() std::chrono::steady_clock::time_point op_start = std::chrono::steady_clock::now()
+  #define C_LESH_PROFILE_OPERATOR(op) this->profiler->Count_Operator(op, op_start)
+  #define C_LESH_PROFILE_READ(address) if (this->profiler) this->profiler->reads[address]++
+  #define C_LESH_PROFILE_WRITE(address) if (this->profiler) this->profiler->writes[address]++
+#else
+  #define C_LESH_PROFILE_COMMAND(address, code)
+  #define C_LESH_PROFILE_END()
+  #define C_LESH_PROFILE_OPERATOR_START()
+  #define C_LESH_PROFILE_OPERATOR(op)
+  #define C_LESH_PROFILE_READ(address)
+  #define C_LESH_PROFILE_WRITE(address)
+#endif
+
+// Define C_LESH_FAULT_CODES to record memory and stack errors of commands in a fault
+// record that becomes an error after the run, instead of throwing from the command.
+#ifdef C_LESH_FAULT_CODES
+  #define C_LESH_FAULT(memory, code, address, row, col, message) (memory)->Raise(code, address, row, col)
+  #define C_LESH_FAULTED() (this->memory->fault.code != eFAULT_NONE)
+  #define C_LESH_NATIVE_FAULTED(clsh) ((clsh).memory->fault.code != eFAULT_NONE)
+  #define C_LESH_CHECK_FAULT() if (C_LESH_FAULTED()) return
+#else
+  #define C_LESH_FAULT(memory, code, address, row, col, message) throw cError(message)
+  #define C_LESH_FAULTED() false
+  #define C_LESH_NATIVE_FAULTED(clsh) false
+  #define C_LESH_CHECK_FAULT()
+#endif
+
+namespace Codeloader {
+
+  enum eCode {
+    eCODE_STORE,
+    eCODE_DUMP,
+    eCODE_TEST,
+    eCODE_JUMP,
+    eCODE_CALL,
+    eCODE_RETURN,
+    eCODE_PUSH,
+    eCODE_POP,
+    eCODE_LOAD,
+    eCODE_SAVE,
+    eCODE_INPUT,
+    eCODE_REFRESH,
+    eCODE_SOUND,
+    eCODE_TIMEOUT,
+    eCODE_OUTPUT,
+    eCODE_STRING,
+    eCODE_PALETTE,
+    eCODE_DRAW,
+    eCODE_CLEAR,
+    eCODE_RESIZE,
+    eCODE_COLUMN,
+    eCODE_STOP,
+    eCODE_COPY,
+    eCODE_BLOCK,
+    eCODE_FILL,
+    eCODE_VECTOR,
+    // Fused commands made by the peephole pass. Programs can not use them.
+    eCODE_INCREMENT_TEST,
+    eCODE_PUSH_CALL,
+    eCODE_MULTI_POP
+  };
+
+  enum eOperator {
+    eOPERATOR_NONE,
+    eOPERATOR_ADD,
+    eOPERATOR_SUBTRACT,
+    eOPERATOR_MULTIPLY,
+    eOPERATOR_DIVIDE,
+    eOPERATOR_REMAINDER,
+    eOPERATOR_RANDOM,
+    eOPERATOR_COSINE,
+    eOPERATOR_SINE
+  };
+
+  enum eAddress {
+    eADDRESS_VALUE,
+    eADDRESS_IMMEDIATE,
+    eADDRESS_POINTER,
+    eADDRESS_STACK,
+    eADDRESS_OBJECT_IMMEDIATE,
+    eADDRESS_OBJECT_POINTER,
+    // Set by the verifier and never decoded from a program.
+    eADDRESS_VERIFIED_IMMEDIATE,
+    eADDRESS_VERIFIED_OBJECT
+  };
+
+  enum eLogic_Operator {
+    eLOGIC_NONE,
+    eLOGIC_AND,
+    eLOGIC_OR
+  };
+
+  enum eTest {
+    eTEST_EQUALS,
+    eTEST_NOT,
+    eTEST_LESS,
+    eTEST_GREATER,
+    eTEST_LESS_OR_EQUAL,
+    eTEST_GREATER_OR_EQUAL
+  };
+
+  enum eFile_Mode {
+    eFILE_LIST,
+    eFILE_TABLE,
+    eFILE_IMAGE
+  };
+
+  enum eSlice {
+    eSLICE_TIME,
+    eSLICE_COMMANDS
+  };
+
+  // Processor draws through the picture processor. Frame draws with C-Lesh's own
+  // frame buffer where cells are RGB colors and negative cells are transparent.
+  enum eRender {
+    eRENDER_PROCESSOR,
+    eRENDER_FRAME
+  };
+
+  enum ePresent {
+    ePRESENT_SYNC,
+    ePRESENT_THREAD
+  };
+
+  enum eFault {
+    eFAULT_NONE,
+    eFAULT_ADDRESS,
+    eFAULT_CELL,
+    eFAULT_STACK_OVERFLOW,
+    eFAULT_STACK_UNDERFLOW,
+    eFAULT_SIZE,
+    eFAULT_RANGE,
+    eFAULT_MODE,
+    eFAULT_OPERATOR
+  };
+
+  enum eImage {
+    eIMAGE_MAGIC = 0x48534C43, // "CLSH" in little endian.
+    eIMAGE_VERSION = 1
+  };
+
+  // Draw modes are flags. Transparent skips picture cells that are negative.
+  enum eDraw {
+    eDRAW_OPAQUE,
+    eDRAW_TRANSPARENT,
+    eDRAW_FLIP,
+    eDRAW_FLIP_TRANSPARENT
+  };
+
+  struct sTable_Slot;
+
+  struct sOperand {
+    int mode;
+    int address;
+    int row;
+  };
+
+  struct sTerm {
+    int op;
+    sOperand operand;
+  };
+
+  struct sExpression {
+    int start;
+    int count;
+    bool constant;
+    int value;
+  };
+
+  struct sCondition {
+    sExpression left;
+    int test;
+    sExpression right;
+    int logic;
+  };
+
+  struct sInstruction {
+    int code;
+    int base;
+    int fused_count;
+    sTable_Slot* fused_slot; // Table of an immediate operand, resolved when the run was fused.
+    int fused_value; // Amount an increment adds.
+    bool fused_test; // The test of an increment test only compares the table with constants.
+    bool decoded;
+    sOperand refs[3];
+    sExpression exprs[6];
+    int cond_start;
+    int cond_count;
+  };
+
+  struct sImage_Header {
+    int32_t magic;
+    int32_t version;
+    int32_t count;
+    int32_t reserved;
+  };
+
+  struct sFault {
+    int code;
+    int command;
+    int opcode;
+    int operand;
+    int address;
+    int row;
+    int col;
+  };
+
+  struct sImage_Entry {
+    int32_t width;
+    int32_t height;
+    int32_t offset;
+  };
+
+  class cImage_File {
+
+    public:
+      char* data;
+      size_t size;
+      int references;
+
+      cImage_File(std::string name);
+      ~cImage_File();
+
+  };
+
+  struct sTable_Slot {
+    int* cells;
+    int width;
+    int height;
+    int stride;
+    int stamp;
+    cImage_File* image;
+  };
+
+  struct sPool {
+    int* cells;
+    int address;
+    int count;
+    int height;
+  };
+
+  struct sCell {
+    sTable_Slot* slot;
+    int address;
+    int offset;
+  };
+
+  struct sPicture {
+    cTable* table;
+    int stamp;
+  };
+
+#ifdef C_LESH_PROFILE
+  struct sProfile_Count {
+    long long count;
+    long long time;
+  };
+
+  class cProfiler {
+
+    public:
+      sProfile_Count codes[eCODE_MULTI_POP + 1];
+      sProfile_Count operators[eOPERATOR_SINE + 1];
+      std::vector<sProfile_Count> commands;
+      std::vector<long long> reads;
+      std::vector<long long> writes;
+      int current_address;
+      int current_code;
+      std::chrono::steady_clock::time_point start;
+
+      cProfiler(int count);
+      void Reset();
+      void Begin_Command(int address, int code);
+      void End_Command();
+      void Count_Operator(int op, std::chrono::steady_clock::time_point start);
+      void Write_Report(std::string name);
+      void Write_Csv(std::string name);
+      void Write_Json(std::string name);
+
+  };
+#endif
+
+#ifdef C_LESH_JIT
+  typedef int (*tJit_Block)();
+
+  class cCode_Buffer {
+
+    public:
+      unsigned char* code;
+      int size;
+      int used;
+
+      cCode_Buffer(int size);
+      ~cCode_Buffer();
+      void Make_Writable();
+      void Make_Executable();
+      void Emit(int byte);
+      void Emit_32(int value);
+      void Emit_64(const void* address);
+      int Emit_Jump(int opcode);
+      void Patch(int position);
+
+  };
+#endif
+
+  class cC_Lesh;
+
+  typedef int (*tNative_Program)(cC_Lesh& clsh, int count);
+
+  struct sNative_Image {
+    const char* name;
+    int address;
+    int count;
+    const sImage_Entry* entries;
+    const int* cells;
+    tNative_Program run;
+  };
+
+  class cMemory {
+
+    public:
+      sTable_Slot* slots;
+      size_t slots_size;
+      std::vector<unsigned char> touched; // One flag per chunk of slots that was set up.
+      int* arena;
+      size_t arena_size;
+      int count;
+      int table_w;
+      int table_h;
+      int table_size;
+      std::map<int, sPicture> pictures;
+      std::vector<cImage_File*> images;
+      int* stack;
+      int stack_address;
+      int stack_count;
+      std::vector<sPool> pools;
+      sFault fault;
+#ifdef C_LESH_PROFILE
+      cProfiler* profiler;
+#endif
+
+      cMemory(int count, int width, int height);
+      ~cMemory();
+      void Clear();
+      void Map_Arena();
+      void* Map_Pages(size_t size);
+      void Zero_Arena();
+      void Unmap_Arena();
+      sTable_Slot& operator[](int address);
+      sTable_Slot& Slot(int address);
+      void Touch(int address);
+      bool Check_Address(int address);
+      bool Is_Spilled(int address);
+      bool Is_Stack(int address);
+      int* Map_Stack(int address, int count);
+      bool Is_Pooled(int address);
+      void Map_Pool(int address, int count, int height);
+      void Unmap_Pools();
+      void Release(int address);
+      int Read(int address, int row, int col);
+      void Write(int address, int row, int col, int value);
+      int Read_Scalar(int address);
+      void Write_Scalar(int address, int value);
+      int Read_Row(int address, int row);
+      void Write_Row(int address, int row, int value);
+      bool Locate(int address, int row, int col, sCell& cell);
+      int Read_Cell(sCell& cell, int next);
+      void Write_Cell(sCell& cell, int next, int value);
+      void Raise(int code, int address, int row, int col);
+      void Clear_Fault();
+      int Read_Unchecked(int address, int row);
+      void Write_Unchecked(int address, int row, int value);
+      bool Resize(int address, int width, int height);
+      void Copy(int destination, int source, int count);
+      void Copy_Block(int destination, int dest_x, int dest_y, int source, int source_x, int source_y, int width, int height);
+      void Fill(int address, int count, int value);
+      bool Import(int address, cTable& table);
+      void Export(int address, cTable& table);
+      cTable& Get_Picture(int address);
+      int Load_Image(std::string name, int address);
+
+  };
+
+  struct sRegion {
+    int x;
+    int y;
+    int width;
+    int height;
+  };
+
+  class cDamage {
+
+    public:
+      std::vector<sRegion> regions;
+      int screen_w;
+      int screen_h;
+      bool full;
+
+      cDamage();
+      void Set_Screen(int width, int height);
+      void Add(int x, int y, int width, int height);
+      void Add_Screen();
+      void Reset();
+      long long Area();
+      std::vector<sRegion>& Get_Regions();
+      void Merge(cDamage& damage);
+
+  };
+
+  typedef void (*tFill_Kernel)(uint32_t* pixels, int count, uint32_t color);
+  typedef void (*tSpan_Kernel)(uint32_t* pixels, const int* cells, int count);
+  typedef void (*tIndex_Kernel)(uint8_t* indices, const int* cells, int count);
+  typedef void (*tExpand_Kernel)(uint32_t* pixels, const uint8_t* indices, const uint32_t* palette, int count);
+
+  struct sBlitter {
+    const char* name;
+    tFill_Kernel fill;
+    tSpan_Kernel spans[eDRAW_FLIP_TRANSPARENT + 1];
+    tIndex_Kernel index_spans[eDRAW_FLIP_TRANSPARENT + 1];
+    tExpand_Kernel expand;
+  };
+
+  class cFrame_Buffer {
+
+    public:
+      std::vector<uint32_t> pixels;
+      std::vector<uint8_t> indices; // Drawn to instead of the pixels when indexed.
+      uint32_t palette[C_LESH_PALETTE_SIZE];
+      bool indexed;
+      int width;
+      int height;
+      const sBlitter* blitter;
+
+      cFrame_Buffer();
+      void Resize(int width, int height);
+      void Clear(uint32_t color);
+      void Blit(const int* cells, int width, int height, int stride, int x, int y, int mode);
+      void Copy_Regions(cFrame_Buffer& source, std::vector<sRegion>& regions);
+      void Expand(std::vector<sRegion>& regions);
+      void Load_Palette(std::string name);
+      int Find_Color(uint32_t color);
+      static int Count_Blitters();
+      static const sBlitter* Get_Blitter(int index);
+      static const sBlitter* Select_Blitter();
+      static void Benchmark(int width, int height);
+      static void Check_Blitters();
+
+  };
+
+  class cGlyph_Atlas;
+
+  // I/O controls that present a frame drawn by C-Lesh itself implement this as well.
+  class cFrame_Display {
+
+    public:
+      virtual ~cFrame_Display() {}
+      virtual void Update_Frame(cFrame_Buffer* frame, std::vector<sRegion>& regions) = 0;
+      virtual bool Can_Present_On_Thread() { return true; }
+      virtual void Bake_Atlas(cGlyph_Atlas& atlas) {} // Displays without a font leave text to Output_Text.
+
+  };
+
+  struct sFrame_Slot {
+    cFrame_Buffer buffer;
+    cDamage stale; // What the buffer is missing from the frame.
+    cDamage pending; // What changed since the last frame presented.
+    std::chrono::steady_clock::time_point published;
+  };
+
+  // Presents frames on its own thread so refresh does not wait for the display.
+  class cPresenter {
+
+    public:
+      cFrame_Display* display;
+      std::vector<sFrame_Slot> slots;
+      int ready;
+      int presenting;
+      bool stopping;
+      long long presented;
+      long long dropped;
+      double total_latency;
+      double max_latency;
+      std::mutex lock;
+      std::condition_variable signal;
+      std::thread thread;
+
+      cPresenter(cFrame_Display* display, int width, int height, int count);
+      ~cPresenter();
+      void Publish(cFrame_Buffer& frame, cDamage& damage);
+      void Finish();
+      void Present_Frames();
+
+  };
+
+  struct sGlyph {
+    int x;
+    int width;
+  };
+
+  class cGlyph_Atlas {
+
+    public:
+      std::vector<uint8_t> coverage; // Glyphs side by side, 1 where there is ink.
+      sGlyph glyphs[256];
+      int width;
+      int height;
+
+      cGlyph_Atlas();
+      void Load(std::string name);
+      void Set_Glyphs(std::vector<int>& codes, std::vector<int>& widths, std::vector<std::string>& rows, int height);
+      void Render(std::string& text, int color, std::vector<int>& cells, int& width);
+
+  };
+
+  struct sText_Image {
+    int width;
+    int height;
+    std::vector<int> cells;
+  };
+
+  // Rendered text by string and color. Images have no position so they can be drawn anywhere.
+  class cText_Cache {
+
+    public:
+      std::map<std::pair<std::string, int>, sText_Image> images;
+      long long hits;
+      long long misses;
+
+      cText_Cache();
+      sText_Image& Get(cGlyph_Atlas& atlas, std::string& text, int color);
+      void Clear();
+
+  };
+
+  class cNull_IO : public cIO_Control, public cFrame_Display {
+
+    public:
+      std::vector<int> signals;
+      int signal_index;
+      std::ofstream log;
+      unsigned int seed;
+      std::atomic<int> frame_count; // Frames may be presented on another thread.
+
+      cNull_IO(std::string input, std::string log);
+      int Get_Random_Number(int lower, int upper);
+      sSignal Read_Signal();
+      void Update_Display(cPicture_Processor* pp);
+      void Update_Frame(cFrame_Buffer* frame, std::vector<sRegion>& regions);
+      void Play_Sound(std::string name);
+      void Timeout(int delay);
+      void Output_Text(std::string text, int x, int y, int red, int green, int blue);
+
+  };
+
+  class cAllegro_Frame_IO : public cAllegro_IO, public cFrame_Display {
+
+    public:
+      ALLEGRO_BITMAP* bitmap;
+      std::string font;
+
+      cAllegro_Frame_IO(std::string title, int width, int height, int scale, std::string font);
+      ~cAllegro_Frame_IO();
+      void Update_Frame(cFrame_Buffer* frame, std::vector<sRegion>& regions);
+      void Bake_Atlas(cGlyph_Atlas& atlas);
+      bool Can_Present_On_Thread();
+
+  };
+
+  class cC_Lesh {
+
+    public:
+      cMemory* memory;
+      cPicture_Processor* pp;
+      cIO_Control* io;
+      int command_pointer;
+      int stack_pointer;
+      int status;
+      int program_start;
+      int program_end;
+      int stack_start;
+      int stack_size;
+      int* stack_cells;
+      std::vector<sInstruction> instructions;
+      std::vector<sTerm> terms;
+      std::vector<sCondition> conditions;
+      int pool_limit;
+      int slice_mode;
+      int slice_budget;
+      int check_interval;
+      sInstruction scratch;
+      std::string program_name;
+      int sample_interval;
+      int sample_countdown;
+      std::map<int, std::string> symbols;
+      std::map<std::string, long long> samples;
+      long long fusion_hits[eCODE_MULTI_POP - eCODE_VECTOR];
+      tNative_Program native;
+      std::vector<int> verified_rows;
+      std::map<int, std::string> diagnostics; // Operands that failed verification, by command address.
+      cFrame_Display* frame_display;
+      int render_mode;
+      cDamage damage;
+      cFrame_Buffer frame;
+      int present_mode;
+      int present_buffers;
+      cPresenter* presenter;
+      cGlyph_Atlas atlas;
+      cText_Cache text_cache;
+      long long frames;
+      long long frame_bytes;
+      long long uploaded_bytes;
+#ifdef C_LESH_JIT
+      cCode_Buffer* jit_code;
+      std::vector<tJit_Block> jit_entries;
+      std::vector<int> jit_lengths;
+      std::vector<int> jit_heat;
+      std::vector<char> jit_covered;
+      int jit_executed;
+      int jit_limit;
+      int jit_blocks;
+#endif
+#ifdef C_LESH_PROFILE
+      cProfiler* profiler;
+#endif
+
+      cC_Lesh(cPicture_Processor* pp, cIO_Control* io, std::string config);
+      ~cC_Lesh();
+      void Load_Program(std::string name);
+      void Load_Native(const sNative_Image& image);
+      void Load_Pools(std::string name);
+      void Translate(std::string name, std::string output);
+      void Translate_Expression(std::ostream& out, sExpression& expression, std::string name, std::vector<sOperand>& operands);
+      std::string Translate_Operand(sOperand& operand, std::vector<sOperand>& operands);
+      std::string Translate_Jump(int address);
+      void Execute_Slice();
+      void Execute(int timeout);
+      void Execute_Commands(int count);
+      int Dispatch(int count);
+      int Interpret(int limit);
+      int Run(int count);
+      void Reset();
+      void Benchmark_Dispatch(std::string name);
+      static void Benchmark_Startup(int width, int height, std::vector<int>& counts);
+      void Set_Screen_Size(int width, int height);
+      void Shutdown();
+      static long long Resident_Memory();
+      void Run_Batch(std::string name);
+      void Report_Speed(std::string label, long long executed, std::chrono::steady_clock::time_point start);
+      void Write_Profile(std::string name);
+      void Report_Fusions();
+      void Dump_Memory(std::string name);
+      void Load_Symbols(std::string name);
+      void Sample_Stack();
+      std::string Symbol_Name(int address, int entry);
+      void Write_Stacks(std::string name);
+      void Decode_Program();
+      void Decode_Range(int address, int count);
+      void Decode_Instruction(int address, sInstruction& instruction);
+      void Decode_Reference(int address, int& row, sOperand& reference);
+      void Decode_Operand(int address, int row, int& col, sOperand& operand);
+      void Decode_Expression(int address, int& row, sExpression& expression);
+      void Decode_Conditional(int address, int& row, sInstruction& instruction);
+      void Fold_Expression(sExpression& expression);
+      void Fold_Test(int address, sInstruction& instruction);
+      void Fuse_Range(int start, int end);
+      bool Is_Origin(sOperand& operand);
+      bool Is_Counter_Test(sInstruction& test, int address);
+      sInstruction& Fetch(int address);
+      void Invalidate(int address);
+      void Invalidate_Range(int address, int count);
+      void Verify_Program();
+      void Verify_Range(int start, int end);
+      void Verify_Instruction(int address, sInstruction& instruction);
+      void Verify_Expression(int address, sExpression& expression);
+      void Verify_Operand(int address, sOperand& operand, bool reference);
+      void Report_Diagnostics();
+      void Check_Shapes(int address, int count);
+      static int Base_Mode(int mode);
+      void Record_Fault(int address);
+      int Fault_Operand(sInstruction& instruction, int address);
+      cError Fault_Error();
+      int Eval_Expression(sExpression& expression);
+      int Apply_Operator(int op, int result, int operand);
+      void Apply_Vector(int op, int* result, const int* left, const int* right, int count);
+      int Eval_Operand(sOperand& operand);
+      int Eval_Conditional(sInstruction& instruction);
+      int Eval_Condition(sCondition& condition);
+      int Apply_Test(int test, int left, int right);
+      int Resolve_Address(sOperand& reference);
+      void Write_Table_At_Address(sOperand& reference, int value);
+      std::string Read_String_At_Address(sOperand& reference);
+      void Store(sInstruction& instruction);
+      void Dump(sInstruction& instruction);
+      void Test(sInstruction& instruction);
+      void Jump(sInstruction& instruction);
+      void Call(sInstruction& instruction);
+      void Push(sInstruction& instruction);
+      void Pop(sInstruction& instruction);
+      void Return(sInstruction& instruction);
+      void Load(sInstruction& instruction);
+      void Save(sInstruction& instruction);
+      void Input(sInstruction& instruction);
+      void Refresh(sInstruction& instruction);
+      void Sound(sInstruction& instruction);
+      void Timeout(sInstruction& instruction);
+      void Output(sInstruction& instruction);
+      void String(sInstruction& instruction);
+      void Palette(sInstruction& instruction);
+      void Draw(sInstruction& instruction);
+      void Clear(sInstruction& instruction);
+      void Resize(sInstruction& instruction);
+      void Column(sInstruction& instruction);
+      void Stop(sInstruction& instruction);
+      void Copy(sInstruction& instruction);
+      void Block(sInstruction& instruction);
+      void Fill(sInstruction& instruction);
+      void Vector(sInstruction& instruction);
+      int Run_Fused(sInstruction& instruction, int limit);
+      void Run_Resolved(sInstruction& first, sInstruction& command);
+#ifdef C_LESH_JIT
+      bool Enter_Jit(int count, int& executed);
+      int Run_Block(int limit);
+      tJit_Block Compile_Block(int address);
+      bool Can_Compile(sInstruction& instruction);
+      bool Can_Compile_Expression(sExpression& expression);
+      void Emit_Operand(int reg, sOperand& operand);
+      void Emit_Expression(sExpression& expression);
+      int Emit_Slot();
+      void Emit_Exit(int target, int executed, int address, int entry);
+      void Flush_Jit();
+#endif
+      void Stack_Push(int value);
+      int Stack_Pop();
+      static int Load_File_List(std::string name, cMemory& memory, int address);
+      static int Load_Table_List(std::string name, cMemory& memory, int address);
+      static void Parse_Table_List(std::string name, std::vector<sImage_Entry>& entries, std::vector<int>& cells);
+      static void Parse_File_List(std::string name, std::vector<sImage_Entry>& entries, std::vector<int>& cells);
+      static void Save_Image(std::string name, std::vector<sImage_Entry>& entries, std::vector<int>& cells);
+      std::string C_Lesh_String_To_Cpp_String(int address, int row);
+
+  };
+
+#ifdef C_LESH_NATIVE
+  // Defined by the translation unit made with "translate".
+  extern const sNative_Image NATIVE_PROGRAM;
+#endif
+
 }
\ No newline at end of file
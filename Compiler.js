@@ -27,6 +27,17 @@ const eCODE_CLEAR = 18;
 const eCODE_RESIZE = 19;
 const eCODE_COLUMN = 20;
 const eCODE_STOP = 21;
+const eCODE_COPY = 22;
+const eCODE_BLOCK = 23;
+const eCODE_FILL = 24;
+const eCODE_VECTOR = 25;
+
+const eOPERATOR_NONE = 0;
+const eOPERATOR_ADD = 1;
+const eOPERATOR_SUBTRACT = 2;
+const eOPERATOR_MULTIPLY = 3;
+const eOPERATOR_DIVIDE = 4;
+const eOPERATOR_REMAINDER = 5;
 
 const eADDRESS_VALUE = 0;
 const eADDRESS_IMMEDIATE = 1;
@@ -38,6 +49,15 @@ const eADDRESS_OBJECT_POINTER = 5;
 var $tokens = [];
 var $symtab = {};
 var $placeholders = {};
+var $objects = {};
+var $pools = [];
+var $operators = {
+  "+": eOPERATOR_ADD,
+  "-": eOPERATOR_SUBTRACT,
+  "*": eOPERATOR_MULTIPLY,
+  "/": eOPERATOR_DIVIDE,
+  "%": eOPERATOR_REMAINDER
+};
 var $pcode = [];
 var $root = __dirname;
 
@@ -59,10 +79,10 @@ class cTable {
     this.rows = [];
     for (var row_index = 0; row_index < height; row_index++) {
       var row = [];
-      for (var col_index = 0; row_index < width; row_index++) {
+      for (var col_index = 0; col_index < width; col_index++) {
         row.push(0);
       }
-      this.rows.push(column);
+      this.rows.push(row);
     }
     this.row_pointer = 0;
     this.col_pointer = 0;
@@ -72,7 +92,7 @@ class cTable {
    * Moves to the next row. Grows the table if needed.
    */
   Move_To_Next_Row() {
-    if (this.row_pointer == this.height) {
+    if (this.row_pointer + 1 == this.height) {
       this.Resize(this.width, this.height + 1);
     }
     this.row_pointer++;
@@ -100,7 +120,7 @@ class cTable {
     for (var row_index = 0; row_index < height; row_index++) {
       var row = [];
       for (var col_index = 0; col_index < width; col_index++) {
-        row.push((this.rows[row_index][col_index] != undefined) ? this.rows[row_index][col_index] : 0);
+        row.push(((row_index < this.height) && (this.rows[row_index][col_index] != undefined)) ? this.rows[row_index][col_index] : 0);
       }
       rows.push(row);
     }
@@ -177,6 +197,8 @@ function Init() {
       var source = process.argv[2];
       Parse_Source(source);
       Parse_Statements();
+      Write_Symbols(source);
+      Write_Pools(source);
     }
     catch (error) {
       console.log("Error: " + error.message);
@@ -227,6 +249,39 @@ function Parse_Source(name) {
   }
 }
 
+/**
+ * Writes out the labels so the call stack sampler can name subroutines. Each line has
+ * a label and its offset from the start of the program.
+ * @param name The name of the program.
+ * @throws An error if the symbol file could not be written.
+ */
+function Write_Symbols(name) {
+  var lines = [];
+  for (var symbol in $symtab) {
+    if (symbol.charAt(0) != "[") { // Defines, maps, and objects are in brackets.
+      lines.push(symbol + "=" + $symtab[symbol]);
+    }
+  }
+  fs.writeFileSync(name + ".clshs", lines.join("\n") + "\n", "utf8");
+}
+
+/**
+ * Writes out the object pools so objects of one type can be stored property by
+ * property. Each line has the type, the offset of the first object from the start of
+ * the program, the number of objects, and the number of properties.
+ * @param name The name of the program.
+ * @throws An error if the pool file could not be written.
+ */
+function Write_Pools(name) {
+  var lines = [];
+  var pool_count = $pools.length;
+  for (var pool_index = 0; pool_index < pool_count; pool_index++) {
+    var pool = $pools[pool_index];
+    lines.push(pool.type + "=" + pool.offset + "," + pool.count + "," + pool.height);
+  }
+  fs.writeFileSync(name + ".clshp", lines.join("\n") + "\n", "utf8");
+}
+
 /**
  * Splits data into platform independent lines.
  * @param data The data string to split.
@@ -292,9 +347,29 @@ function Parse_Statements() {
       var entry = Parse_Token();
       var index = 0;
       while (entry.token != "end") {
-        $symtab["[" + name + "->" + entry.token + "]"] = index++;
+        $symtab["[" + name.token + "->" + entry.token + "]"] = index++;
         entry = Parse_Token();
       }
+      $objects[name.token] = index;
+    }
+    else if (command.token == "objects") {
+      var name = Parse_Token();
+      if ($objects[name.token] == undefined) {
+        Generate_Parse_Error("Object " + name.token + " is not defined.", name);
+      }
+      Parse_Keyword("count");
+      var count = Text_To_Number(Parse_Token().token);
+      var height = $objects[name.token];
+      $pools.push({
+        type: name.token,
+        offset: $pcode.length,
+        count: count,
+        height: height
+      });
+      for (var object_index = 0; object_index < count; object_index++) {
+        var table = new cTable(1, height);
+        $pcode.push(table);
+      }
     }
     else if (command.token == "label") {
       var name = Parse_Token();
@@ -319,6 +394,50 @@ function Parse_Statements() {
       var table = new cTable(width, height);
       $pcode.push(table);
     }
+    else if (command.token == "copy") { // copy <destination> <source> <count>
+      var table = new cTable(1, 1);
+      table.Write_Column(eCODE_COPY);
+      Parse_Command_Reference(table);
+      Parse_Command_Reference(table);
+      Parse_Expression(table);
+      $pcode.push(table);
+    }
+    else if (command.token == "block") { // block <destination> <x> <y> <source> <x> <y> <width> <height>
+      var table = new cTable(1, 1);
+      table.Write_Column(eCODE_BLOCK);
+      Parse_Command_Reference(table);
+      Parse_Expression(table);
+      Parse_Expression(table);
+      Parse_Command_Reference(table);
+      for (var expr_index = 0; expr_index < 4; expr_index++) {
+        Parse_Expression(table);
+      }
+      $pcode.push(table);
+    }
+    else if (command.token == "fill") { // fill <table> <value> <count>
+      var table = new cTable(1, 1);
+      table.Write_Column(eCODE_FILL);
+      Parse_Command_Reference(table);
+      Parse_Expression(table);
+      Parse_Expression(table);
+      $pcode.push(table);
+    }
+    else if (command.token == "vector") { // vector <destination> <left> <operator> <right>
+      var table = new cTable(1, 1);
+      table.Write_Column(eCODE_VECTOR);
+      Parse_Command_Reference(table);
+      Parse_Command_Reference(table);
+      var op = Parse_Token();
+      if ($operators[op.token] == undefined) {
+        Generate_Parse_Error("Invalid operator.", op);
+      }
+      table.Move_To_Next_Row();
+      table.Write_Column(eADDRESS_VALUE);
+      table.Write_Column($operators[op.token]);
+      table.Write_Column(eOPERATOR_NONE);
+      Parse_Command_Reference(table);
+      $pcode.push(table);
+    }
     else if (command.token == "matrices") {
       var width = Text_To_Number(Parse_Token().token);
       var height = Text_To_Number(Parse_Token().token);
@@ -488,6 +607,32 @@ function Parse_Reference(command) {
   }
 }
 
+/**
+ * Parses a table reference of a command onto a row of its own.
+ * @param command The command where the reference is.
+ * @throws An error if the reference is invalid.
+ */
+function Parse_Command_Reference(command) {
+  command.Move_To_Next_Row();
+  Parse_Reference(command);
+}
+
+/**
+ * Parses an expression of a command onto a row of its own. Operands are separated by
+ * operators and the row ends with no operator.
+ * @param command The command where the expression is.
+ * @throws An error if an operand is invalid.
+ */
+function Parse_Expression(command) {
+  command.Move_To_Next_Row();
+  Parse_Reference(command);
+  while (($tokens.length > 0) && ($operators[$tokens[0].token] != undefined)) {
+    command.Write_Column($operators[Parse_Token().token]);
+    Parse_Reference(command);
+  }
+  command.Write_Column(eOPERATOR_NONE);
+}
+
 /**
  * Parses a number or placeholder from text.
  * @param text The number or placeholder text.
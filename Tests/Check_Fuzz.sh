@@ -0,0 +1,68 @@
+#!/bin/sh
+# ============================================================================
+# C-Lesh Fuzz Check
+# Programmed by Francois Lamini
+# ============================================================================
+# Generates random programs with Fuzz.js and runs each of them with the plain
+# interpreter, the interpreter with the JIT and the interpreter with fault codes.
+# The log, the final memory and any error of every build have to be the same,
+# except for where the fault code build says an error happened.
+# Programs that differ are kept in the work folder.
+#
+# Usage: Check_Fuzz.sh [<count> [<first seed>]]
+#
+# CXX, CXXFLAGS and LIBS are passed to the compiler. CXXFLAGS has to find
+# Code_Helper and LIBS has to link whatever it needs, e.g. Allegro.
+
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:-"-std=c++11 -O2 -pthread"}
+LIBS=${LIBS:-}
+NODE=${NODE:-node}
+TESTS=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(cd "$TESTS/.." && pwd)
+SOURCE=$ROOT/C_Lesh.cpp
+WORK=${WORK:-$TESTS/Fuzz_Work}
+COUNT=${1:-100}
+SEED=${2:-1}
+BUILDS="Interpreter Jit Faults"
+
+mkdir -p "$WORK" || exit 1
+cp "$ROOT/Config.txt" "$WORK/Config.txt" || exit 1
+cd "$WORK" || exit 1
+echo "Building interpreters."
+$CXX $CXXFLAGS "$SOURCE" -o Interpreter $LIBS || exit 1
+$CXX $CXXFLAGS -DC_LESH_JIT "$SOURCE" -o Jit $LIBS || exit 1
+$CXX $CXXFLAGS -DC_LESH_FAULT_CODES "$SOURCE" -o Faults $LIBS || exit 1
+
+failed=0
+errors=0
+last=$((SEED + COUNT - 1))
+for seed in $(seq "$SEED" "$last"); do
+  program=Fuzz_$seed
+  $NODE "$TESTS/Fuzz.js" "$program" "$seed" || exit 1
+  rm -f "$program.clshb"
+  for build in $BUILDS; do
+    "./$build" "$program" 64 64 batch "" "$program.${build}_Log.txt" "$program.${build}_Dump.txt" |
+      grep "^Error" | sed "s/ by command .*$/./" > "$program.${build}_Error.txt" # Fault codes also tell where.
+  done
+  same=1
+  for build in $BUILDS; do
+    for part in Log Dump Error; do
+      if ! cmp -s "$program.Interpreter_$part.txt" "$program.${build}_$part.txt"; then
+        echo "$program: $build differs"
+        diff "$program.Interpreter_$part.txt" "$program.${build}_$part.txt" | head -20
+        same=0
+      fi
+    done
+  done
+  if [ -s "$program.Interpreter_Error.txt" ]; then
+    errors=$((errors + 1))
+  fi
+  if [ $same -eq 1 ]; then
+    rm -f "$program".*
+  else
+    failed=1
+  fi
+done
+echo "$COUNT programs checked, $errors stopped with an error."
+exit $failed
@@ -0,0 +1,53 @@
+#!/bin/sh
+# ============================================================================
+# C-Lesh Translator Check
+# Programmed by Francois Lamini
+# ============================================================================
+# Runs every program in this folder with the interpreter, translates it to C++,
+# builds and runs the translation, and compares the log and final memory of both.
+#
+# Usage: Check_Translate.sh [<program> ...]
+#
+# CXX, CXXFLAGS and LIBS are passed to the compiler. CXXFLAGS has to find
+# Code_Helper and LIBS has to link whatever it needs, e.g. Allegro.
+
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:-"-std=c++11 -O2 -pthread"}
+LIBS=${LIBS:-}
+TESTS=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(cd "$TESTS/.." && pwd)
+SOURCE=$ROOT/C_Lesh.cpp
+WORK=${WORK:-$TESTS/Translate_Work}
+
+mkdir -p "$WORK" || exit 1
+cp "$ROOT/Config.txt" "$WORK/Config.txt" || exit 1
+cd "$WORK" || exit 1
+echo "Building interpreter."
+$CXX $CXXFLAGS "$SOURCE" -o Interpreter $LIBS || exit 1
+
+if [ $# -eq 0 ]; then
+  set -- $(cd "$TESTS" && ls *.clshc | sed "s/\.clshc$//")
+fi
+failed=0
+for program in "$@"; do
+  cp "$TESTS/$program.clshc" "$program.clshc" || exit 1
+  rm -f "$program.clshb"
+  ./Interpreter "$program" 64 64 batch "" "$program.Interpreted_Log.txt" "$program.Interpreted_Dump.txt" > /dev/null
+  ./Interpreter translate "$program" "$program.Native.cpp" > /dev/null
+  if ! $CXX $CXXFLAGS -DC_LESH_NATIVE -I"$ROOT" "$SOURCE" "$program.Native.cpp" -o "$program.Native" $LIBS; then
+    echo "$program: translation does not build"
+    failed=1
+    continue
+  fi
+  "./$program.Native" "$program" 64 64 batch "" "$program.Native_Log.txt" "$program.Native_Dump.txt" > /dev/null
+  if cmp -s "$program.Interpreted_Log.txt" "$program.Native_Log.txt" &&
+     cmp -s "$program.Interpreted_Dump.txt" "$program.Native_Dump.txt"; then
+    echo "$program: same"
+  else
+    echo "$program: differs"
+    diff "$program.Interpreted_Log.txt" "$program.Native_Log.txt"
+    diff "$program.Interpreted_Dump.txt" "$program.Native_Dump.txt"
+    failed=1
+  fi
+done
+exit $failed
@@ -0,0 +1,515 @@
+// ============================================================================
+// C-Lesh Program Fuzzer
+// Programmed by Francois Lamini
+// ============================================================================
+var fs = require("fs");
+
+const eCODE_STORE = 0;
+const eCODE_TEST = 2;
+const eCODE_JUMP = 3;
+const eCODE_CALL = 4;
+const eCODE_RETURN = 5;
+const eCODE_PUSH = 6;
+const eCODE_POP = 7;
+const eCODE_RESIZE = 19;
+const eCODE_STOP = 21;
+
+const eOPERATOR_NONE = 0;
+const eOPERATOR_ADD = 1;
+const eOPERATOR_SUBTRACT = 2;
+const eOPERATOR_MULTIPLY = 3;
+const eOPERATOR_DIVIDE = 4;
+const eOPERATOR_REMAINDER = 5;
+
+const eADDRESS_VALUE = 0;
+const eADDRESS_IMMEDIATE = 1;
+const eADDRESS_POINTER = 2;
+const eADDRESS_STACK = 3;
+const eADDRESS_OBJECT_IMMEDIATE = 4;
+const eADDRESS_OBJECT_POINTER = 5;
+
+const eLOGIC_NONE = 0;
+const eLOGIC_AND = 1;
+const eLOGIC_OR = 2;
+
+const eTEST_EQUALS = 0;
+const eTEST_GREATER_OR_EQUAL = 5;
+
+const PROGRAM_START = 20; // Has to match the program in Config.txt.
+const DATA_START = 500;
+const DATA_COUNT = 12;
+const POINTER_START = 520;
+const POINTER_COUNT = 4;
+const COUNTER_START = 530; // One counter per loop depth, the outer loop is the first.
+const MAX_DEPTH = 2;
+const ROW_COUNT = 4;
+const BOUND = 10007; // Keeps values far away from overflowing.
+const TAKE_NO_JUMP = -1;
+
+var $seed = 1;
+var $commands = [];
+var $labels = {};
+var $label_count = 0;
+var $subroutines = [];
+
+// ****************************************************************************
+// General API
+// ****************************************************************************
+
+/**
+ * Initializes the fuzzer.
+ */
+function Init() {
+  if (process.argv.length == 4) {
+    try {
+      var name = process.argv[2];
+      $seed = (Number(process.argv[3]) >>> 0) || 1;
+      Generate_Program();
+      Write_Program(name);
+    }
+    catch (error) {
+      console.log("Error: " + error.message);
+    }
+  }
+  else {
+    console.log("Usage: " + process.argv[1] + " <program> <seed>");
+  }
+}
+
+/**
+ * Generates a random number from the seed. The same seed always generates the same
+ * program.
+ * @param low The lowest number.
+ * @param high The highest number.
+ * @return A number between low and high inclusive.
+ */
+function Random_Number(low, high) {
+  $seed ^= $seed << 13;
+  $seed ^= $seed >>> 17;
+  $seed ^= $seed << 5;
+  $seed >>>= 0;
+  return low + ($seed % (high - low + 1));
+}
+
+/**
+ * Picks a random item from a list.
+ * @param list The list.
+ * @return One of the items.
+ */
+function Random_Item(list) {
+  return list[Random_Number(0, list.length - 1)];
+}
+
+/**
+ * Creates a new label for a command.
+ * @return The name of the label.
+ */
+function New_Label() {
+  return "L" + ($label_count++);
+}
+
+/**
+ * Places a label at the next command.
+ * @param label The name of the label.
+ */
+function Place_Label(label) {
+  $labels[label] = $commands.length;
+}
+
+/**
+ * Adds a command. Each row is an array of numbers and labels.
+ * @param rows The rows of the command.
+ */
+function Add_Command(rows) {
+  $commands.push(rows);
+}
+
+// ****************************************************************************
+// Operands and Expressions
+// ****************************************************************************
+
+/**
+ * Generates an operand that is read.
+ * @param args The number of arguments on the stack, or -1 outside of a subroutine.
+ * @return The operand as cells of an expression row.
+ */
+function Generate_Operand(args) {
+  var operand = null;
+  switch (Random_Number(0, (args >= 0) ? 6 : 5)) {
+    case 0:
+    case 1: {
+      operand = [ eADDRESS_VALUE, Random_Number(-50, 50) ];
+      break;
+    }
+    case 2: {
+      operand = [ eADDRESS_IMMEDIATE, Random_Number(DATA_START, COUNTER_START + MAX_DEPTH) ]; // Counters can be read.
+      break;
+    }
+    case 3: {
+      operand = [ eADDRESS_POINTER, POINTER_START + Random_Number(0, POINTER_COUNT - 1) ];
+      break;
+    }
+    case 4: {
+      operand = [ eADDRESS_OBJECT_IMMEDIATE, DATA_START + Random_Number(0, DATA_COUNT - 1), Random_Number(0, ROW_COUNT - 1) ];
+      break;
+    }
+    case 5: {
+      operand = [ eADDRESS_OBJECT_POINTER, POINTER_START + Random_Number(0, POINTER_COUNT - 1), Random_Number(0, ROW_COUNT - 1) ];
+      break;
+    }
+    case 6: {
+      operand = [ eADDRESS_STACK, Random_Number(1, args + 1) ]; // The first is the return address.
+      break;
+    }
+  }
+  return operand;
+}
+
+/**
+ * Generates a reference that is written to.
+ * @param args The number of arguments on the stack, or -1 outside of a subroutine.
+ * @return The rows of the reference.
+ */
+function Generate_Reference(args) {
+  var rows = null;
+  switch (Random_Number(0, (args > 0) ? 4 : 3)) {
+    case 0: {
+      rows = [ [ eADDRESS_IMMEDIATE, DATA_START + Random_Number(0, DATA_COUNT - 1) ] ];
+      break;
+    }
+    case 1: {
+      rows = [ [ eADDRESS_POINTER, POINTER_START + Random_Number(0, POINTER_COUNT - 1) ] ];
+      break;
+    }
+    case 2: {
+      rows = [ [ eADDRESS_OBJECT_IMMEDIATE, DATA_START + Random_Number(0, DATA_COUNT - 1) ], [ Random_Number(0, ROW_COUNT - 1) ] ];
+      break;
+    }
+    case 3: {
+      rows = [ [ eADDRESS_OBJECT_POINTER, POINTER_START + Random_Number(0, POINTER_COUNT - 1) ], [ Random_Number(0, ROW_COUNT - 1) ] ];
+      break;
+    }
+    case 4: {
+      rows = [ [ eADDRESS_STACK, Random_Number(2, args + 1) ] ]; // Never the return address.
+      break;
+    }
+  }
+  return rows;
+}
+
+/**
+ * Generates an expression row. Only one term may multiply and only by a small number,
+ * and anything longer than one operand is brought back into bounds, so that no
+ * build overflows.
+ * @param args The number of arguments on the stack, or -1 outside of a subroutine.
+ * @return The expression row.
+ */
+function Generate_Expression(args) {
+  var row = Generate_Operand(args);
+  var term_count = Random_Number(0, 3);
+  var multiplied = false;
+  for (var term_index = 0; term_index < term_count; term_index++) {
+    var op = Random_Item([ eOPERATOR_ADD, eOPERATOR_SUBTRACT, eOPERATOR_MULTIPLY, eOPERATOR_DIVIDE, eOPERATOR_REMAINDER ]);
+    if (op == eOPERATOR_MULTIPLY) {
+      if (multiplied) {
+        op = eOPERATOR_ADD;
+      }
+      else {
+        multiplied = true;
+        row = row.concat([ op, eADDRESS_VALUE, Random_Number(-9, 9) ]);
+        continue;
+      }
+    }
+    row = row.concat([ op ], Generate_Operand(args));
+  }
+  if (term_count > 0) {
+    row = row.concat([ eOPERATOR_REMAINDER, eADDRESS_VALUE, BOUND ]);
+  }
+  row.push(eOPERATOR_NONE);
+  return row;
+}
+
+/**
+ * Generates an expression whose value is known but that is not a constant, so it is
+ * evaluated when it runs.
+ * @param value The value of the expression.
+ * @return The expression row.
+ */
+function Generate_Hidden_Value(value) {
+  return [ eADDRESS_IMMEDIATE, DATA_START + Random_Number(0, DATA_COUNT - 1), eOPERATOR_MULTIPLY, eADDRESS_VALUE, 0,
+    eOPERATOR_ADD, eADDRESS_VALUE, value, eOPERATOR_NONE ];
+}
+
+/**
+ * Generates the expression of a jump target.
+ * @param label The label of the target, or nothing for no jump.
+ * @return The expression row.
+ */
+function Generate_Target(label) {
+  var target = (label != undefined) ? label : TAKE_NO_JUMP;
+  return (Random_Number(0, 4) == 0) ? Generate_Hidden_Value(target) : [ eADDRESS_VALUE, target, eOPERATOR_NONE ];
+}
+
+/**
+ * Applies a test like the interpreter does.
+ * @param test The test.
+ * @param left The left value.
+ * @param right The right value.
+ * @return True if the test passes.
+ */
+function Apply_Test(test, left, right) {
+  var diff = right - left;
+  return [ diff == 0, diff != 0, diff < 0, diff > 0, diff <= 0, diff >= 0 ][test];
+}
+
+// ****************************************************************************
+// Commands
+// ****************************************************************************
+
+/**
+ * Generates a store, an increment or a resize.
+ * @param args The number of arguments on the stack, or -1 outside of a subroutine.
+ */
+function Generate_Store(args) {
+  switch (Random_Number(0, 5)) {
+    case 0: {
+      var table = DATA_START + Random_Number(0, DATA_COUNT - 1);
+      Add_Command([ [ eCODE_STORE ], [ eADDRESS_IMMEDIATE, table ],
+        [ eADDRESS_IMMEDIATE, table, Random_Item([ eOPERATOR_ADD, eOPERATOR_SUBTRACT ]), eADDRESS_VALUE, Random_Number(-5, 5), eOPERATOR_NONE ] ]);
+      break;
+    }
+    case 1: {
+      Add_Command([ [ eCODE_RESIZE ], [ eADDRESS_IMMEDIATE, DATA_START + Random_Number(0, DATA_COUNT - 1) ],
+        [ eADDRESS_VALUE, Random_Number(1, 3), eOPERATOR_NONE ], [ eADDRESS_VALUE, (Random_Number(0, 7) == 0) ? ROW_COUNT - 1 : ROW_COUNT + Random_Number(0, 1), eOPERATOR_NONE ] ]); // Rarely loses a row.
+      break;
+    }
+    default: {
+      Add_Command([ [ eCODE_STORE ] ].concat(Generate_Reference(args), [ Generate_Expression(args) ]));
+    }
+  }
+}
+
+/**
+ * Generates a test that skips the commands after it when it passes or fails.
+ * @param args The number of arguments on the stack, or -1 outside of a subroutine.
+ * @param depth The depth of loops.
+ */
+function Generate_Branch(args, depth) {
+  var skip = New_Label();
+  var rows = [ [ eCODE_TEST ] ];
+  var cond_count = Random_Number(1, 2);
+  for (var cond_index = 0; cond_index < cond_count; cond_index++) {
+    rows.push(Generate_Expression(args));
+    rows.push([ Random_Number(eTEST_EQUALS, eTEST_GREATER_OR_EQUAL) ]);
+    rows.push(Generate_Expression(args));
+    rows.push([ (cond_index < cond_count - 1) ? Random_Item([ eLOGIC_AND, eLOGIC_OR ]) : eLOGIC_NONE ]);
+  }
+  if (Random_Number(0, 1)) {
+    rows.push(Generate_Target(skip), Generate_Target());
+  }
+  else {
+    rows.push(Generate_Target(), Generate_Target(skip));
+  }
+  Add_Command(rows);
+  Generate_Commands(args, depth, Random_Number(1, 3));
+  Place_Label(skip);
+}
+
+/**
+ * Generates a jump over commands that never run.
+ * @param args The number of arguments on the stack, or -1 outside of a subroutine.
+ */
+function Generate_Jump(args) {
+  var skip = New_Label();
+  Add_Command([ [ eCODE_JUMP ], Generate_Target(skip) ]);
+  Generate_Store(args);
+  Place_Label(skip);
+}
+
+/**
+ * Generates a loop that counts a table of its own. The test of the counter is random,
+ * but only tests that stop after a few times around are used.
+ * @param args The number of arguments on the stack, or -1 outside of a subroutine.
+ * @param depth The depth of the loop.
+ * @param times About how many times the loop goes around.
+ * @param size The number of commands or groups of commands in the loop.
+ */
+function Generate_Loop(args, depth, times, size) {
+  var counter = COUNTER_START + depth;
+  var start = 0;
+  var step = 0;
+  var limit = 0;
+  var test = eTEST_EQUALS;
+  var counter_left = false;
+  var back_on_pass = false;
+  for (var try_index = 0; try_index < 100; try_index++) {
+    start = Random_Number(-20, 20);
+    step = Random_Item([ -3, -2, -1, 1, 2, 3 ]);
+    limit = start + step * Random_Number(Math.ceil(times / 2), times) + Random_Number(-2, 2);
+    test = Random_Number(eTEST_EQUALS, eTEST_GREATER_OR_EQUAL);
+    counter_left = (Random_Number(0, 1) == 1);
+    back_on_pass = (Random_Number(0, 1) == 1);
+    var value = start;
+    var count = 0;
+    var again = true;
+    while (again && (count <= times + 2)) {
+      value += step;
+      count++;
+      var passed = counter_left ? Apply_Test(test, value, limit) : Apply_Test(test, limit, value);
+      again = (passed == back_on_pass);
+    }
+    if (!again) {
+      break;
+    }
+    test = eTEST_EQUALS; // The fallback always stops.
+    limit = start + step;
+    back_on_pass = false;
+  }
+  var top = New_Label();
+  Add_Command([ [ eCODE_STORE ], [ eADDRESS_IMMEDIATE, counter ], [ eADDRESS_VALUE, start, eOPERATOR_NONE ] ]);
+  Place_Label(top);
+  Generate_Commands(args, depth, size);
+  Add_Command([ [ eCODE_STORE ], [ eADDRESS_IMMEDIATE, counter ],
+    [ eADDRESS_IMMEDIATE, counter, (step > 0) ? eOPERATOR_ADD : eOPERATOR_SUBTRACT, eADDRESS_VALUE, Math.abs(step), eOPERATOR_NONE ] ]);
+  var counter_side = [ eADDRESS_IMMEDIATE, counter, eOPERATOR_NONE ];
+  var limit_side = (Random_Number(0, 3) == 0) ? Generate_Hidden_Value(limit) : [ eADDRESS_VALUE, limit, eOPERATOR_NONE ];
+  var rows = [ [ eCODE_TEST ], counter_left ? counter_side : limit_side, [ test ], counter_left ? limit_side : counter_side, [ eLOGIC_NONE ] ];
+  if (back_on_pass) {
+    rows.push(Generate_Target(top), Generate_Target());
+  }
+  else {
+    rows.push(Generate_Target(), Generate_Target(top));
+  }
+  Add_Command(rows);
+}
+
+/**
+ * Generates values pushed on the stack, commands that use them and pops that take
+ * them off again.
+ */
+function Generate_Stack() {
+  var count = Random_Number(1, 3);
+  for (var push_index = 0; push_index < count; push_index++) {
+    Add_Command([ [ eCODE_PUSH ], Generate_Expression(-1) ]);
+  }
+  var store_count = Random_Number(0, 2);
+  for (var store_index = 0; store_index < store_count; store_index++) {
+    var reference = (Random_Number(0, 1) == 1) ? [ [ eADDRESS_STACK, Random_Number(1, count) ] ] : Generate_Reference(-1);
+    var row = [ eADDRESS_STACK, Random_Number(1, count), Random_Item([ eOPERATOR_ADD, eOPERATOR_SUBTRACT ]) ].concat(Generate_Operand(-1),
+      [ eOPERATOR_REMAINDER, eADDRESS_VALUE, BOUND, eOPERATOR_NONE ]);
+    Add_Command([ [ eCODE_STORE ] ].concat(reference, [ row ]));
+  }
+  for (var pop_index = 0; pop_index < count; pop_index++) {
+    Add_Command([ [ eCODE_POP ] ].concat(Generate_Reference(-1)));
+  }
+}
+
+/**
+ * Generates a call of a subroutine with its arguments pushed before and popped after.
+ */
+function Generate_Call() {
+  var subroutine = Random_Item($subroutines);
+  for (var arg_index = 0; arg_index < subroutine.args; arg_index++) {
+    Add_Command([ [ eCODE_PUSH ], Generate_Expression(-1) ]);
+  }
+  Add_Command([ [ eCODE_CALL ], Generate_Target(subroutine.label) ]);
+  for (var pop_index = 0; pop_index < subroutine.args; pop_index++) {
+    Add_Command([ [ eCODE_POP ] ].concat(Generate_Reference(-1)));
+  }
+}
+
+/**
+ * Generates random commands.
+ * @param args The number of arguments on the stack, or -1 outside of a subroutine.
+ * @param depth The depth of loops.
+ * @param count The number of commands or groups of commands.
+ */
+function Generate_Commands(args, depth, count) {
+  for (var command_index = 0; command_index < count; command_index++) {
+    var kind = Random_Number(0, 9);
+    if ((kind == 0) && (depth < MAX_DEPTH)) {
+      Generate_Loop(args, depth + 1, 6, Random_Number(1, 4));
+    }
+    else if (kind == 1) {
+      Generate_Branch(args, depth);
+    }
+    else if (kind == 2) {
+      Generate_Jump(args);
+    }
+    else if ((kind == 3) && (args < 0)) {
+      Generate_Stack();
+    }
+    else if ((kind == 4) && (args < 0)) {
+      Generate_Call();
+    }
+    else {
+      Generate_Store(args);
+    }
+  }
+}
+
+/**
+ * Generates a whole program. It shapes the data, points the pointers into it, runs
+ * random commands in an outer loop and stops. The subroutines come after the stop.
+ */
+function Generate_Program() {
+  var subroutine_count = Random_Number(1, 3);
+  for (var subroutine_index = 0; subroutine_index < subroutine_count; subroutine_index++) {
+    $subroutines.push({
+      label: New_Label(),
+      args: Random_Number(0, 3)
+    });
+  }
+  for (var data_index = 0; data_index < DATA_COUNT; data_index++) {
+    Add_Command([ [ eCODE_RESIZE ], [ eADDRESS_IMMEDIATE, DATA_START + data_index ],
+      [ eADDRESS_VALUE, 1, eOPERATOR_NONE ], [ eADDRESS_VALUE, ROW_COUNT, eOPERATOR_NONE ] ]);
+  }
+  for (var pointer_index = 0; pointer_index < POINTER_COUNT; pointer_index++) {
+    Add_Command([ [ eCODE_STORE ], [ eADDRESS_IMMEDIATE, POINTER_START + pointer_index ],
+      [ eADDRESS_VALUE, DATA_START + Random_Number(0, DATA_COUNT - 1), eOPERATOR_NONE ] ]);
+  }
+  Generate_Loop(-1, 0, Random_Number(50, 200), Random_Number(8, 20));
+  Add_Command([ [ eCODE_STOP ] ]);
+  for (var subroutine_index = 0; subroutine_index < subroutine_count; subroutine_index++) {
+    var subroutine = $subroutines[subroutine_index];
+    Place_Label(subroutine.label);
+    Generate_Commands(subroutine.args, MAX_DEPTH, Random_Number(1, 4));
+    Add_Command([ [ eCODE_RETURN ] ]);
+  }
+}
+
+/**
+ * Writes the program with the labels replaced by addresses.
+ * @param name The name of the program.
+ * @throws An error if the program could not be written.
+ */
+function Write_Program(name) {
+  var lines = [];
+  var command_count = $commands.length;
+  for (var command_index = 0; command_index < command_count; command_index++) {
+    var rows = $commands[command_index];
+    var width = 0;
+    for (var row_index = 0; row_index < rows.length; row_index++) {
+      width = Math.max(width, rows[row_index].length);
+    }
+    lines.push(width + "x" + rows.length);
+    for (var row_index = 0; row_index < rows.length; row_index++) {
+      var row = [];
+      for (var col_index = 0; col_index < width; col_index++) {
+        var cell = rows[row_index][col_index];
+        if (typeof cell == "string") {
+          cell = PROGRAM_START + $labels[cell];
+        }
+        row.push((cell != undefined) ? cell : 0);
+      }
+      lines.push(row.join(" "));
+    }
+  }
+  fs.writeFileSync(name + ".clshc", lines.join("\n") + "\n", "utf8");
+}
+
+// ****************************************************************************
+// Program Entry Point
+// ****************************************************************************
+
+Init();